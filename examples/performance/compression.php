@@ -0,0 +1,101 @@
+<?php
+################################################################################
+# Copyright 2013-2015 Aerospike, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+################################################################################
+require_once(realpath(__DIR__ . '/util.php'));
+function parse_args() {
+    $shortopts = "";
+    $shortopts .= "h::"; /* Optional host */
+    $shortopts .= "p::"; /* Optional port */
+    $shortopts .= "n::"; /* Optionally number of puts and gets of each fragment size */
+    $longopts = array(
+        "host::", /* Optional host */
+        "port::", /* Optional port */
+        "num-ops::", /* Optionally number of puts and gets of each fragment size */
+        "help", /* Usage */
+    );
+    $options = getopt($shortopts, $longopts);
+    return $options;
+}
+function per_call($label, $ops, $fails, $delta) {
+    $color = ($fails > 0) ? 'red' : 'green';
+    echo colorize("$label: $ops calls, $fails failed\n", $color, true);
+    $usec = ($delta * 1000000) / $ops;
+    $tps = ($ops / $delta);
+    echo colorize("Total time: {$delta}s TPS:$tps Per call: {$usec}us\n", 'purple', true);
+}
+$args = parse_args();
+if (isset($args["help"])) {
+    echo "php compression.php [-hHOST] [-pPORT] [-nOPERATIONS]\n";
+    echo " or\n";
+    echo "php compression.php [--host=HOST] [--port=PORT] [--num-ops=OPERATIONS]\n";
+    exit(1);
+}
+$addr = (isset($args["h"])) ? (string) $args["h"] : ((isset($args["host"])) ? (string) $args["host"] : "localhost");
+$port = (isset($args["p"])) ? (integer) $args["p"] : ((isset($args["port"])) ? (string) $args["port"] : 3000);
+$total_ops = (isset($args["n"])) ? (integer) $args["n"] : ((isset($args["num-ops"])) ? (string) $args["num-ops"] : 1000);
+echo colorize("Connecting to the host ≻", 'black', true);
+$config = array("hosts" => array(array("addr" => $addr, "port" => $port)));
+$db = new Aerospike($config);
+if (!$db->isConnected()) {
+    echo fail("Could not connect to host $addr:$port [{$db->errorno()}]: {$db->error()}");
+    exit(1);
+}
+echo success();
+$key = $db->initKey("test", "performance", "compression");
+
+/* Cached HTML fragments, wrapped in an object so that they are serialized,
+   put and got uncompressed and then compressed */
+$row = "<tr class=\"row\"><td class=\"name\">Item %d</td><td class=\"price\">%d.99</td></tr>\n";
+foreach (array(20480, 204800) as $size) {
+    $html = "";
+    for ($i = 0; strlen($html) < $size; $i++) {
+        $html .= sprintf($row, $i, $i % 100);
+    }
+    $fragment = new stdClass();
+    $fragment->html = $html;
+    $record = array("fragment" => $fragment);
+    foreach (array("0" => "Uncompressed", "16384" => "Compressed") as $threshold => $label) {
+        ini_set("aerospike.compression_threshold", $threshold);
+        echo colorize("$label put of a $size bytes fragment $total_ops times ≻", 'black', true);
+        $fails = 0;
+        $begin = microtime(true);
+        for ($num_ops = 0; $num_ops < $total_ops; $num_ops++) {
+            if ($db->put($key, $record) !== Aerospike::OK) {
+                $fails++;
+            }
+        }
+        $end = microtime(true);
+        echo ($fails == 0) ? success() : standard_fail($db);
+        per_call("$label puts", $total_ops, $fails, $end - $begin);
+
+        echo colorize("$label get of a $size bytes fragment $total_ops times ≻", 'black', true);
+        $fails = 0;
+        $begin = microtime(true);
+        for ($num_ops = 0; $num_ops < $total_ops; $num_ops++) {
+            if ($db->get($key, $read) !== Aerospike::OK || $read["bins"]["fragment"]->html !== $html) {
+                $fails++;
+            }
+        }
+        $end = microtime(true);
+        echo ($fails == 0) ? success() : standard_fail($db);
+        per_call("$label gets", $total_ops, $fails, $end - $begin);
+    }
+}
+ini_restore("aerospike.compression_threshold");
+
+$db->remove($key);
+$db->close();
+?>
@@ -0,0 +1,79 @@
+<?php
+################################################################################
+# Copyright 2013-2015 Aerospike, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+################################################################################
+require_once(realpath(__DIR__ . '/util.php'));
+function parse_args() {
+    $shortopts = "";
+    $shortopts .= "h::"; /* Optional host */
+    $shortopts .= "p::"; /* Optional port */
+    $shortopts .= "n::"; /* Optionally number of constructs */
+    $longopts = array(
+        "host::", /* Optional host */
+        "port::", /* Optional port */
+        "num-ops::", /* Optionally number of constructs */
+        "help", /* Usage */
+    );
+    if (php_sapi_name() !== 'cli') {
+        /* Served by an HHVM server, take the options from the query string */
+        return $_GET;
+    }
+    $options = getopt($shortopts, $longopts);
+    return $options;
+}
+$args = parse_args();
+if (isset($args["help"])) {
+    echo "php construct.php [-hHOST] [-pPORT] [-nCONSTRUCTS]\n";
+    echo " or\n";
+    echo "php construct.php [--host=HOST] [--port=PORT] [--num-ops=CONSTRUCTS]\n";
+    exit(1);
+}
+$addr = (isset($args["h"])) ? (string) $args["h"] : ((isset($args["host"])) ? (string) $args["host"] : "localhost");
+$port = (isset($args["p"])) ? (integer) $args["p"] : ((isset($args["port"])) ? (string) $args["port"] : 3000);
+$total_ops = (isset($args["n"])) ? (integer) $args["n"] : ((isset($args["num-ops"])) ? (string) $args["num-ops"] : 100000);
+echo colorize("Connecting to the host ≻", 'black', true);
+$config = array("hosts" => array(array("addr" => $addr, "port" => $port)));
+$db = new Aerospike($config);
+if (!$db->isConnected()) {
+    echo fail("Could not connect to host $addr:$port [{$db->errorno()}]: {$db->error()}");
+    exit(1);
+}
+echo success();
+$constructs = 0;
+$construct_fails = 0;
+$begin = microtime(true);
+echo colorize("Construct $total_ops persistent connections ≻", 'black', true);
+for ($num_ops = 1; $num_ops <= $total_ops; $num_ops++) {
+    $client = new Aerospike($config);
+    $constructs++;
+    if (!$client->isConnected()) {
+        $construct_fails++;
+    }
+    unset($client);
+}
+$end = microtime(true);
+if ($construct_fails == 0) {
+    echo success();
+} else {
+    echo standard_fail($db);
+}
+echo colorize("$constructs sequential constructs\n", 'green', true);
+$color = ($construct_fails > 0) ? 'red' : 'green';
+echo colorize("Failed constructs: $construct_fails\n", $color, true);
+$delta = $end - $begin;
+$tps = ($constructs / $delta);
+echo colorize("Total time: {$delta}s TPS:$tps\n", 'purple', true);
+$db->close();
+?>
@@ -0,0 +1,90 @@
+<?php
+################################################################################
+# Copyright 2013-2015 Aerospike, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+################################################################################
+require_once(realpath(__DIR__ . '/util.php'));
+function parse_args() {
+    $shortopts = "";
+    $shortopts .= "h::"; /* Optional host */
+    $shortopts .= "p::"; /* Optional port */
+    $shortopts .= "n::"; /* Optionally number of gets of each bin */
+    $longopts = array(
+        "host::", /* Optional host */
+        "port::", /* Optional port */
+        "num-ops::", /* Optionally number of gets of each bin */
+        "help", /* Usage */
+    );
+    $options = getopt($shortopts, $longopts);
+    return $options;
+}
+function per_call($label, $ops, $fails, $delta) {
+    $color = ($fails > 0) ? 'red' : 'green';
+    echo colorize("$label: $ops calls, $fails failed\n", $color, true);
+    $usec = ($delta * 1000000) / $ops;
+    $tps = ($ops / $delta);
+    echo colorize("Total time: {$delta}s TPS:$tps Per call: {$usec}us\n", 'purple', true);
+}
+$args = parse_args();
+if (isset($args["help"])) {
+    echo "php get-collections.php [-hHOST] [-pPORT] [-nOPERATIONS]\n";
+    echo " or\n";
+    echo "php get-collections.php [--host=HOST] [--port=PORT] [--num-ops=OPERATIONS]\n";
+    exit(1);
+}
+$addr = (isset($args["h"])) ? (string) $args["h"] : ((isset($args["host"])) ? (string) $args["host"] : "localhost");
+$port = (isset($args["p"])) ? (integer) $args["p"] : ((isset($args["port"])) ? (string) $args["port"] : 3000);
+$total_ops = (isset($args["n"])) ? (integer) $args["n"] : ((isset($args["num-ops"])) ? (string) $args["num-ops"] : 1000);
+echo colorize("Connecting to the host ≻", 'black', true);
+$config = array("hosts" => array(array("addr" => $addr, "port" => $port)));
+$db = new Aerospike($config);
+if (!$db->isConnected()) {
+    echo fail("Could not connect to host $addr:$port [{$db->errorno()}]: {$db->error()}");
+    exit(1);
+}
+echo success();
+/* A record with a 10k element list bin and a 10k element map bin, read one
+   bin at a time, so that the time per call is dominated by building the
+   PHP array */
+$key = $db->initKey("test", "performance", "get-collections");
+$list = array();
+$map = array();
+for ($i = 0; $i < 10000; $i++) {
+    $list[] = $i;
+    $map["k$i"] = $i;
+}
+echo colorize("Put a record with 10000 element list and map bins ≻", 'black', true);
+if ($db->put($key, array("list" => $list, "map" => $map)) !== Aerospike::OK) {
+    echo standard_fail($db);
+    exit(1);
+}
+echo success();
+
+foreach (array("list", "map") as $bin) {
+    echo colorize("Get the 10000 element $bin bin $total_ops times ≻", 'black', true);
+    $fails = 0;
+    $begin = microtime(true);
+    for ($num_ops = 0; $num_ops < $total_ops; $num_ops++) {
+        if ($db->get($key, $read, array($bin)) !== Aerospike::OK) {
+            $fails++;
+        }
+    }
+    $end = microtime(true);
+    echo ($fails == 0) ? success() : standard_fail($db);
+    per_call("Gets of the $bin bin", $total_ops, $fails, $end - $begin);
+}
+
+$db->remove($key);
+$db->close();
+?>
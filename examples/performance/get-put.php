@@ -0,0 +1,98 @@
+<?php
+################################################################################
+# Copyright 2013-2015 Aerospike, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+################################################################################
+require_once(realpath(__DIR__ . '/util.php'));
+function parse_args() {
+    $shortopts = "";
+    $shortopts .= "h::"; /* Optional host */
+    $shortopts .= "p::"; /* Optional port */
+    $shortopts .= "n::"; /* Optionally number of operations of each kind */
+    $longopts = array(
+        "host::", /* Optional host */
+        "port::", /* Optional port */
+        "num-ops::", /* Optionally number of operations of each kind */
+        "help", /* Usage */
+    );
+    $options = getopt($shortopts, $longopts);
+    return $options;
+}
+function per_call($label, $ops, $fails, $delta) {
+    $color = ($fails > 0) ? 'red' : 'green';
+    echo colorize("$label: $ops calls, $fails failed\n", $color, true);
+    $usec = ($delta * 1000000) / $ops;
+    $tps = ($ops / $delta);
+    echo colorize("Total time: {$delta}s TPS:$tps Per call: {$usec}us\n", 'purple', true);
+}
+$args = parse_args();
+if (isset($args["help"])) {
+    echo "php get-put.php [-hHOST] [-pPORT] [-nOPERATIONS]\n";
+    echo " or\n";
+    echo "php get-put.php [--host=HOST] [--port=PORT] [--num-ops=OPERATIONS]\n";
+    exit(1);
+}
+$addr = (isset($args["h"])) ? (string) $args["h"] : ((isset($args["host"])) ? (string) $args["host"] : "localhost");
+$port = (isset($args["p"])) ? (integer) $args["p"] : ((isset($args["port"])) ? (string) $args["port"] : 3000);
+$total_ops = (isset($args["n"])) ? (integer) $args["n"] : ((isset($args["num-ops"])) ? (string) $args["num-ops"] : 100000);
+echo colorize("Connecting to the host ≻", 'black', true);
+$config = array("hosts" => array(array("addr" => $addr, "port" => $port)));
+$db = new Aerospike($config);
+if (!$db->isConnected()) {
+    echo fail("Could not connect to host $addr:$port [{$db->errorno()}]: {$db->error()}");
+    exit(1);
+}
+echo success();
+/* A single small record keeps the server side cost flat, so that the
+   per call cost of the client surfaces */
+$key = $db->initKey("test", "performance", "get-put");
+$record = array("v" => 1);
+
+echo colorize("Put the same record $total_ops times ≻", 'black', true);
+$put_fails = 0;
+$begin = microtime(true);
+for ($num_ops = 0; $num_ops < $total_ops; $num_ops++) {
+    if ($db->put($key, $record) !== Aerospike::OK) {
+        $put_fails++;
+    }
+}
+$end = microtime(true);
+echo ($put_fails == 0) ? success() : standard_fail($db);
+per_call("Puts", $total_ops, $put_fails, $end - $begin);
+
+echo colorize("Get the same record $total_ops times ≻", 'black', true);
+$get_fails = 0;
+$begin = microtime(true);
+for ($num_ops = 0; $num_ops < $total_ops; $num_ops++) {
+    if ($db->get($key, $read) !== Aerospike::OK) {
+        $get_fails++;
+    }
+}
+$end = microtime(true);
+echo ($get_fails == 0) ? success() : standard_fail($db);
+per_call("Gets", $total_ops, $get_fails, $end - $begin);
+
+echo colorize("Get a missing record $total_ops times ≻", 'black', true);
+$missing = $db->initKey("test", "performance", "get-put-missing");
+$begin = microtime(true);
+for ($num_ops = 0; $num_ops < $total_ops; $num_ops++) {
+    $db->get($missing, $read);
+}
+$end = microtime(true);
+echo success();
+per_call("Failed gets", $total_ops, 0, $end - $begin);
+
+$db->remove($key);
+$db->close();
+?>
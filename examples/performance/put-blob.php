@@ -0,0 +1,92 @@
+<?php
+################################################################################
+# Copyright 2013-2015 Aerospike, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+################################################################################
+require_once(realpath(__DIR__ . '/util.php'));
+function parse_args() {
+    $shortopts = "";
+    $shortopts .= "h::"; /* Optional host */
+    $shortopts .= "p::"; /* Optional port */
+    $shortopts .= "n::"; /* Optionally number of puts for each value size */
+    $longopts = array(
+        "host::", /* Optional host */
+        "port::", /* Optional port */
+        "num-ops::", /* Optionally number of puts for each value size */
+        "help", /* Usage */
+    );
+    $options = getopt($shortopts, $longopts);
+    return $options;
+}
+function per_call($label, $ops, $fails, $delta) {
+    $color = ($fails > 0) ? 'red' : 'green';
+    echo colorize("$label: $ops calls, $fails failed\n", $color, true);
+    $usec = ($delta * 1000000) / $ops;
+    $tps = ($ops / $delta);
+    echo colorize("Total time: {$delta}s TPS:$tps Per call: {$usec}us\n", 'purple', true);
+}
+function time_puts($db, $key, $record, $total_ops) {
+    $fails = 0;
+    $begin = microtime(true);
+    for ($num_ops = 0; $num_ops < $total_ops; $num_ops++) {
+        if ($db->put($key, $record) !== Aerospike::OK) {
+            $fails++;
+        }
+    }
+    $end = microtime(true);
+    return array($fails, $end - $begin);
+}
+$args = parse_args();
+if (isset($args["help"])) {
+    echo "php put-blob.php [-hHOST] [-pPORT] [-nOPERATIONS]\n";
+    echo " or\n";
+    echo "php put-blob.php [--host=HOST] [--port=PORT] [--num-ops=OPERATIONS]\n";
+    exit(1);
+}
+$addr = (isset($args["h"])) ? (string) $args["h"] : ((isset($args["host"])) ? (string) $args["host"] : "localhost");
+$port = (isset($args["p"])) ? (integer) $args["p"] : ((isset($args["port"])) ? (string) $args["port"] : 3000);
+$total_ops = (isset($args["n"])) ? (integer) $args["n"] : ((isset($args["num-ops"])) ? (string) $args["num-ops"] : 1000);
+echo colorize("Connecting to the host ≻", 'black', true);
+$config = array("hosts" => array(array("addr" => $addr, "port" => $port)));
+$db = new Aerospike($config);
+if (!$db->isConnected()) {
+    echo fail("Could not connect to host $addr:$port [{$db->errorno()}]: {$db->error()}");
+    exit(1);
+}
+echo success();
+$key = $db->initKey("test", "performance", "put-blob");
+
+/* Each value size is put as a string bin, and as a PHP serialized bin,
+   first through the legacy write path then with the value's buffer pinned
+   and wrapped in place */
+foreach (array(1024, 16384, 131072, 1048576) as $size) {
+    $string_record = array("v" => str_repeat("a", $size));
+    $blob_record = array("v" => array(str_repeat("a", $size)));
+    foreach (array("false" => "Legacy", "true" => "Zero-copy") as $zero_copy => $label) {
+        ini_set("aerospike.zero_copy_writes", $zero_copy);
+        echo colorize("$label put of a $size bytes string $total_ops times ≻", 'black', true);
+        list($fails, $delta) = time_puts($db, $key, $string_record, $total_ops);
+        echo ($fails == 0) ? success() : standard_fail($db);
+        per_call("$label string puts", $total_ops, $fails, $delta);
+
+        echo colorize("$label put of a $size bytes serialized value $total_ops times ≻", 'black', true);
+        list($fails, $delta) = time_puts($db, $key, $blob_record, $total_ops);
+        echo ($fails == 0) ? success() : standard_fail($db);
+        per_call("$label serialized puts", $total_ops, $fails, $delta);
+    }
+}
+
+$db->remove($key);
+$db->close();
+?>
@@ -0,0 +1,103 @@
+<?php
+################################################################################
+# Copyright 2013-2015 Aerospike, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+################################################################################
+require_once(realpath(__DIR__ . '/util.php'));
+function parse_args() {
+    $shortopts = "";
+    $shortopts .= "h::"; /* Optional host */
+    $shortopts .= "p::"; /* Optional port */
+    $shortopts .= "n::"; /* Optionally number of puts and gets with each serializer */
+    $longopts = array(
+        "host::", /* Optional host */
+        "port::", /* Optional port */
+        "num-ops::", /* Optionally number of puts and gets with each serializer */
+        "help", /* Usage */
+    );
+    $options = getopt($shortopts, $longopts);
+    return $options;
+}
+function per_call($label, $ops, $fails, $delta) {
+    $color = ($fails > 0) ? 'red' : 'green';
+    echo colorize("$label: $ops calls, $fails failed\n", $color, true);
+    $usec = ($delta * 1000000) / $ops;
+    $tps = ($ops / $delta);
+    echo colorize("Total time: {$delta}s TPS:$tps Per call: {$usec}us\n", 'purple', true);
+}
+$args = parse_args();
+if (isset($args["help"])) {
+    echo "php serializers.php [-hHOST] [-pPORT] [-nOPERATIONS]\n";
+    echo " or\n";
+    echo "php serializers.php [--host=HOST] [--port=PORT] [--num-ops=OPERATIONS]\n";
+    exit(1);
+}
+$addr = (isset($args["h"])) ? (string) $args["h"] : ((isset($args["host"])) ? (string) $args["host"] : "localhost");
+$port = (isset($args["p"])) ? (integer) $args["p"] : ((isset($args["port"])) ? (string) $args["port"] : 3000);
+$total_ops = (isset($args["n"])) ? (integer) $args["n"] : ((isset($args["num-ops"])) ? (string) $args["num-ops"] : 1000);
+echo colorize("Connecting to the host ≻", 'black', true);
+$config = array("hosts" => array(array("addr" => $addr, "port" => $port)));
+$db = new Aerospike($config);
+if (!$db->isConnected()) {
+    echo fail("Could not connect to host $addr:$port [{$db->errorno()}]: {$db->error()}");
+    exit(1);
+}
+echo success();
+$key = $db->initKey("test", "performance", "serializers");
+
+/* A typical document: a list of nested user profiles, decoded from JSON into
+   stdClass objects, which are not Aerospike types and get serialized */
+$users = array();
+for ($i = 0; $i < 100; $i++) {
+    $users[] = array("id" => $i, "name" => "user $i", "email" => "user$i@example.com",
+        "active" => ($i % 2 == 0), "score" => $i * 1.5, "tags" => array("a", "b", "c"),
+        "address" => array("street" => "$i Main St", "city" => "Springfield", "zip" => 10000 + $i));
+}
+$document = json_decode(json_encode(array("users" => $users)));
+$record = array("doc" => $document);
+/* The JSON serialized values are plain blobs, only decoded when asked to */
+ini_set("aerospike.decode_json", "true");
+
+foreach (array(Aerospike::SERIALIZER_PHP => "PHP serializer",
+    Aerospike::SERIALIZER_BINARY => "Binary serializer",
+    Aerospike::SERIALIZER_JSON => "JSON serializer") as $serializer => $label) {
+    $options = array(Aerospike::OPT_SERIALIZER => $serializer);
+    echo colorize("$label put of the document $total_ops times ≻", 'black', true);
+    $fails = 0;
+    $begin = microtime(true);
+    for ($num_ops = 0; $num_ops < $total_ops; $num_ops++) {
+        if ($db->put($key, $record, 0, $options) !== Aerospike::OK) {
+            $fails++;
+        }
+    }
+    $end = microtime(true);
+    echo ($fails == 0) ? success() : standard_fail($db);
+    per_call("$label puts", $total_ops, $fails, $end - $begin);
+
+    echo colorize("$label get of the document $total_ops times ≻", 'black', true);
+    $fails = 0;
+    $begin = microtime(true);
+    for ($num_ops = 0; $num_ops < $total_ops; $num_ops++) {
+        if ($db->get($key, $read) !== Aerospike::OK || $read["bins"]["doc"] != $document) {
+            $fails++;
+        }
+    }
+    $end = microtime(true);
+    echo ($fails == 0) ? success() : standard_fail($db);
+    per_call("$label gets", $total_ops, $fails, $end - $begin);
+}
+
+$db->remove($key);
+$db->close();
+?>
@@ -4,8 +4,13 @@ HHVM_EXTENSION(aerospike-hhvm
     main/policy.cpp
     main/helper.cpp
     main/batch_op_manager.cpp
+    main/batch_write_manager.cpp
+    main/batch_read_manager.cpp
     main/scan_operation.cpp
-    main/udf_operations.cpp)
+    main/udf_operations.cpp
+    main/connection_registry.cpp
+    main/lazy_record.cpp
+    main/serializers.cpp)
 HHVM_DEFINE(aerospike-hhvm -DAEROSPIKE_C_CHECK)
 include_directories(include)
 target_link_libraries(aerospike-hhvm /usr/lib/libaerospike.so)
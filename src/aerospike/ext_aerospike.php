@@ -1,4 +1,5 @@
 <?hh
+namespace {
 <<__NativeData("Aerospike")>>
 class Aerospike {
     <<__Native>>
@@ -13,6 +14,8 @@ class Aerospike {
         public static function setSerializer(mixed $callback = NULL): bool;
     <<__Native>>
         public static function setDeserializer(mixed $callback = NULL): bool;
+    <<__Native>>
+        public static function setBatchDeserializer(mixed $callback = NULL): bool;
     <<__Native>>
         public function put(array $key, array $rec, int $ttl=0, mixed $options = NULL): int;
     <<__Native>>
@@ -25,6 +28,10 @@ class Aerospike {
         public function getMany(array $keys, mixed& $records, mixed $filter = NULL, mixed $options = NULL): int;
     <<__Native>>
         public function getManyDirect(array $keys, mixed $filter = NULL, mixed $options = NULL): array;
+    <<__Native>>
+        public function getManyStream(array $keys, mixed $function, mixed $filter = NULL, mixed $options = NULL): int;
+    <<__Native>>
+        public function batchRead(array $entries, mixed& $records, mixed $options = NULL): int;
     <<__Native>>
         public function operate(array $key, array $operations, mixed& $returned = NULL, mixed $options = NULL): int;
     <<__Native>>
@@ -35,6 +42,12 @@ class Aerospike {
         public function exists(array $key, mixed& $metadata, mixed $options = NULL): int;
     <<__Native>>
         public function existsMany(array $keys, mixed& $metadata, mixed $options = NULL): int;
+    <<__Native>>
+        public function putMany(array $keys, array $records, mixed& $statuses = NULL, int $ttl = 0, mixed $options = NULL): int;
+    <<__Native>>
+        public function removeMany(array $keys, mixed& $statuses = NULL, mixed $options = NULL): int;
+    <<__Native>>
+        public function operateMany(array $keys, array $operations, mixed& $statuses = NULL, mixed& $returned = NULL, mixed $options = NULL): int;
     <<__Native>>
         public function getKeyDigest(mixed $ns, mixed $set, mixed $key): string;
     <<__Native>>
@@ -69,6 +82,8 @@ class Aerospike {
         public function errorno(): int;
     <<__Native>>
         public function error(): string;
+    <<__Native>>
+        public function getInstanceStats(mixed& $stats): int;
 
     public function initKey(mixed $ns, mixed $set, mixed $key, bool $digest = false) {
         if ((!is_int($ns) && !is_string($ns)) ||
@@ -122,4 +137,28 @@ class Aerospike {
         return $this->operate($key, $operations, $returned, $options);
     }
 }
+}
 
+namespace Aerospike {
+<<__NativeData("AerospikeRecord")>>
+final class Record implements \ArrayAccess, \Countable {
+    <<__Native>>
+        public function offsetExists(mixed $bin): bool;
+    <<__Native>>
+        public function offsetGet(mixed $bin): mixed;
+    <<__Native>>
+        public function offsetSet(mixed $bin, mixed $value): void;
+    <<__Native>>
+        public function offsetUnset(mixed $bin): void;
+    <<__Native>>
+        public function count(): int;
+    <<__Native>>
+        public function getKey(): array;
+    <<__Native>>
+        public function getMetadata(): array;
+    <<__Native>>
+        public function getBins(): array;
+    <<__Native>>
+        public function toArray(): array;
+}
+}
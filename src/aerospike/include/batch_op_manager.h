@@ -4,6 +4,10 @@
 #include "hphp/runtime/ext/extension.h"
 #include "hphp/runtime/base/execution-context.h"
 #include "hphp/runtime/vm/native-data.h"
+#include "conversions.h"
+
+#include <functional>
+#include <vector>
 
 extern "C" {
 #include "aerospike/aerospike.h"
@@ -31,28 +35,107 @@ namespace HPHP {
      * 1. Use execute_batch_exists() to perform a batch exists operation on the
      * keys provided in the constructor; returns the collective metadata of the
      * said records within the VRefParam php_metadata.
+     * 1. Use size() and key_at() to get the parsed keys, as BatchWriteManager
+     * does for batch writes.
      * 1. Use execute_batch_get() to perform a batch get operation on the
      * keys provided in the constructor; returns all the said records within
      * the VRefParam php_records.
+     * Both return a list aligned with the keys, with NULL for the records
+     * not found, when is_positional is set (OPT_POSITIONAL_RESULTS).
+     * 1. Use execute_batch_get_stream() to perform a batch get operation
+     * which passes the records to a PHP callback, one by one or in chunks,
+     * instead of returning them all.
+     * Batches of more than aerospike.batch_max_keys keys are split into
+     * chunks, read concurrently and passed to the callbacks in the order of
+     * the keys, as if read by a single batch.
      ************************************************************************************
      */
     class BatchOpManager {
         private:
+            /*
+             * Runs the C client's batch read of the given as_batch, with the
+             * given callback and udata
+             */
+            typedef std::function<void(as_batch *batch_p,
+                    aerospike_batch_read_callback callback, void *udata,
+                    as_error& error)> batch_command;
+
+            /*
+             * A chunk of the keys read by a worker thread, along with its
+             * results, which are kept until passed to the callback on the
+             * request thread
+             */
+            struct batch_chunk {
+                as_batch                    batch;
+                std::vector<as_batch_read>  results;
+                as_error                    error;
+            };
+
             as_batch batch;
             static void populate_result_for_get_exists_many(as_key *key_p,
-                    Array& outer_meta_array, Array& inner_meta_array,
+                    Array& outer_meta_array, const Variant& inner_meta_array,
                     as_error& error);
             static bool batch_exists_cb(const as_batch_read* results, uint32_t n, void* udata);
             static bool batch_get_cb(const as_batch_read* results, uint32_t n, void* udata);
+            static bool batch_get_stream_cb(const as_batch_read* results, uint32_t n, void* udata);
+            static as_status batch_read_to_php_record(const as_batch_read *result_p,
+                    Variant& record, BinNameTable *bin_names_p, bool is_lazy_record,
+                    as_error& error);
+            static bool batch_collect_cb(const as_batch_read* results, uint32_t n, void* udata);
+            void init_positional_result(Array& php_result);
+            as_status batch_get(aerospike *as_p, const Variant& filter_bins,
+                    as_policy_batch& batch_policy, aerospike_batch_read_callback callback,
+                    void *udata, as_error& error, const bool *is_stopped_p = NULL);
+            as_status execute_in_chunks(const batch_command& command,
+                    aerospike_batch_read_callback callback, void *udata,
+                    as_error& error, const bool *is_stopped_p);
         public:
             BatchOpManager();
             ~BatchOpManager();
             BatchOpManager(const Array& php_keys);
+            uint32_t size() const { return this->batch.keys.size; }
+            as_key* key_at(uint32_t index) { return as_batch_keyat(&this->batch, index); }
             as_status execute_batch_exists(aerospike *as_p, Array &php_metadata,
-                    as_policy_batch& batch_policy, as_error& error);
+                    as_policy_batch& batch_policy, as_error& error,
+                    bool is_positional = false);
             as_status execute_batch_get(aerospike *as_p, Array &php_records,
                     const Variant& filter_bins, as_policy_batch& batch_policy,
-                    as_error& error);
+                    as_error& error, bool is_lazy_record = false,
+                    bool is_positional = false);
+            as_status execute_batch_get_stream(aerospike *as_p,
+                    const Variant& function, int64_t chunk_size,
+                    const Variant& filter_bins, const Array& boolean_bins,
+                    as_policy_batch& batch_policy, as_error& error,
+                    bool is_lazy_record = false);
     };
+
+    /*
+     ************************************************************************************
+     * Structure declaration for batch_stream_udata.
+     * Holds the 'function' the records are passed to, 'error' to be populated
+     * in case of errors, the 'bin_names' of the records, the bins hinted as
+     * booleans, the first key of the batch (to get the position of the key
+     * of a result), the number of records passed per call (0 for one record
+     * per call), whether the records are passed as Aerospike\Record objects,
+     * and whether the function asked to stop by returning false.
+     ************************************************************************************
+     */
+    typedef struct __batch_stream_udata {
+        const Variant& function;
+        as_error& error;
+        BinNameTable bin_names;
+        const Array& boolean_bins;
+        const as_key *first_key_p = NULL;
+        int64_t chunk_size = 0;
+        bool is_lazy_record = false;
+        bool is_stopped = false;
+        __batch_stream_udata(const Variant& init_function, as_error& init_error,
+                const Array& init_boolean_bins) : function(init_function),
+                error(init_error), boolean_bins(init_boolean_bins) {}
+    } batch_stream_udata;
+
+    extern bool is_positional_results_requested(const Variant& options);
+    extern as_status get_stream_chunk_size(const Variant& options, int64_t& chunk_size,
+            as_error& error);
 }
 #endif /* end of __BATCH_OP_MANAGER_H__ */
@@ -0,0 +1,52 @@
+#ifndef __BATCH_READ_MANAGER_H__
+#define __BATCH_READ_MANAGER_H__
+
+#include "hphp/runtime/ext/extension.h"
+#include "hphp/runtime/base/execution-context.h"
+#include "hphp/runtime/vm/native-data.h"
+
+extern "C" {
+#include "aerospike/aerospike.h"
+#include "aerospike/aerospike_batch.h"
+#include "aerospike/as_status.h"
+#include "aerospike/as_policy.h"
+}
+
+#include <vector>
+
+namespace HPHP {
+    /*
+     ************************************************************************************
+     * BatchReadManager class to invoke the batch read of records selected
+     * per key, aka Aerospike::batchRead().
+     * In order to instantiate this class, specify the PHP array of entries to
+     * be read, each with its own key and bin names, or no bins to read the
+     * metadata only. The keys may belong to different namespaces.
+     * The constructor parses the entries into the C client's
+     * as_batch_read_records, in chunks of up to aerospike.batch_max_keys
+     * entries, and throws if an entry is invalid.
+     * The destructor destroys the maintained as_batch_read_records.
+     ************************************************************************************
+     * Methods:
+     ************************************************************************************
+     * 1. Use execute_batch_read() to read the chunks concurrently on up to
+     * aerospike.batch_concurrency threads; returns the records within
+     * php_records, a list in the order of the entries, with NULL for the
+     * records not found.
+     ************************************************************************************
+     */
+    class BatchReadManager {
+        private:
+            std::vector<as_batch_read_records>  chunks;
+            std::vector<std::vector<char *>>    bin_names;
+
+            void destroy();
+        public:
+            BatchReadManager(const Array& php_entries);
+            ~BatchReadManager();
+            as_status execute_batch_read(aerospike *as_p, Array& php_records,
+                    const Array& boolean_bins, as_policy_batch& batch_policy,
+                    as_error& error, bool is_lazy_record = false);
+    };
+}
+#endif /* end of __BATCH_READ_MANAGER_H__ */
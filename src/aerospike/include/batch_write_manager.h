@@ -0,0 +1,70 @@
+#ifndef __BATCH_WRITE_MANAGER_H__
+#define __BATCH_WRITE_MANAGER_H__
+
+#include "hphp/runtime/ext/extension.h"
+#include "hphp/runtime/base/execution-context.h"
+#include "hphp/runtime/vm/native-data.h"
+
+extern "C" {
+#include "aerospike/aerospike.h"
+#include "aerospike/aerospike_key.h"
+#include "aerospike/as_operations.h"
+#include "aerospike/as_status.h"
+#include "aerospike/as_policy.h"
+}
+
+#include <mutex>
+#include <vector>
+
+#include "batch_op_manager.h"
+
+namespace HPHP {
+    class StaticPoolManager;
+
+    /*
+     ************************************************************************************
+     * BatchWriteManager class to invoke the following batch operations:
+     * 1. batch put() aka Aerospike::putMany()
+     * 2. batch remove() aka Aerospike::removeMany()
+     * 3. batch operate() aka Aerospike::operateMany()
+     * In order to instantiate this class, specify the PHP keys array to be used
+     * in the specific batch operation. The keys are parsed by a BatchOpManager.
+     * The C client has no batch write command, so the writes are run as single
+     * key commands on up to aerospike.batch_concurrency threads, the thread of
+     * the request and threads of the process wide worker pool, which reach
+     * the nodes of the keys concurrently. Everything the threads use is
+     * converted into C client structures beforehand, so they never touch
+     * HHVM values.
+     ************************************************************************************
+     * Methods:
+     ************************************************************************************
+     * Each execute_*() method returns the status of every key within
+     * php_statuses, a list in the order of the keys, and AEROSPIKE_OK if every
+     * key succeeded. Otherwise the error of the first key which failed.
+     ************************************************************************************
+     */
+    class BatchWriteManager {
+        private:
+            BatchOpManager          batch_keys;
+            std::vector<as_status>  statuses;
+            std::mutex              error_mutex;
+            as_error                first_error;
+            uint32_t                first_error_index;
+
+            void start();
+            void set_status(uint32_t index, const as_error& key_error);
+            as_status get_statuses(Array& php_statuses, as_error& error);
+        public:
+            BatchWriteManager(const Array& php_keys);
+            as_status execute_put_many(aerospike *as_p, const Array& php_records,
+                    int64_t ttl, uint16_t gen, as_policy_write& write_policy,
+                    StaticPoolManager& static_pool, int16_t serializer_type,
+                    Array& php_statuses, as_error& error);
+            as_status execute_remove_many(aerospike *as_p, as_policy_remove& remove_policy,
+                    Array& php_statuses, as_error& error);
+            as_status execute_operate_many(aerospike *as_p, as_operations& operations,
+                    as_policy_operate& operate_policy, Array& php_statuses,
+                    Array& php_returned, as_error& error);
+    };
+}
+#endif /* end of __BATCH_WRITE_MANAGER_H__ */
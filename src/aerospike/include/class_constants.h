@@ -84,6 +84,7 @@ namespace HPHP {
         { SERIALIZER_PHP                        ,   "SERIALIZER_PHP"                    },
         { SERIALIZER_JSON                       ,   "SERIALIZER_JSON"                   },
         { SERIALIZER_USER                       ,   "SERIALIZER_USER"                   },
+        { SERIALIZER_BINARY                     ,   "SERIALIZER_BINARY"                 },
         { AS_UDF_TYPE_LUA                       ,   "UDF_TYPE_LUA"                      },
         { AS_SCAN_PRIORITY_AUTO                 ,   "SCAN_PRIORITY_AUTO"                },
         { AS_SCAN_PRIORITY_LOW                  ,   "SCAN_PRORITY_LOW"                  },
@@ -117,6 +118,13 @@ namespace HPHP {
         { AS_OPERATOR_APPEND                    ,   "OPERATOR_APPEND"                   },
         { AS_OPERATOR_TOUCH                     ,   "OPERATOR_TOUCH"                    },
         { OPT_TTL                               ,   "OPT_TTL"                           },
+        { OPT_CONNECT_LAZY                      ,   "OPT_CONNECT_LAZY"                  },
+        { OPT_BOOLEAN_BINS                      ,   "OPT_BOOLEAN_BINS"                  },
+        { OPT_LAZY_RECORD                       ,   "OPT_LAZY_RECORD"                   },
+        { OPT_COLLECTIONS                       ,   "OPT_COLLECTIONS"                   },
+        { OPT_POSITIONAL_RESULTS                ,   "OPT_POSITIONAL_RESULTS"            },
+        { OPT_STREAM_CHUNK_SIZE                 ,   "OPT_STREAM_CHUNK_SIZE"             },
+        { OPT_DECODE_JSON                       ,   "OPT_DECODE_JSON"                   },
 };
 
 #define EXTENSION_CONSTANTS_SIZE (sizeof(extension_constants)/sizeof(aerospike_constants))
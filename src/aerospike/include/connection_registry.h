@@ -0,0 +1,67 @@
+#ifndef __CONNECTION_REGISTRY_H__
+#define __CONNECTION_REGISTRY_H__
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "hphp/runtime/ext/extension.h"
+#include "ext_aerospike.h"
+
+namespace HPHP {
+    /*
+     ************************************************************************************
+     * ConnectionRegistry class to maintain the process wide persistent
+     * connections (cluster id => aerospike_ref) shared by all HHVM request
+     * threads. The cluster id is the hash of the sorted host list plus the user
+     * (see get_cluster_id()), so that a lookup never allocates.
+     * The registry is split into CONNECTION_REGISTRY_SHARDS shards selected by
+     * the cluster id. Each shard publishes an immutable snapshot of its
+     * map through an atomic pointer, so that lookups take no lock at all.
+     * Writers serialize on the shard mutex, copy the current snapshot, add the
+     * new entry and publish the copy. Retired snapshots are kept until
+     * clear() is called on module shutdown, since readers may still be
+     * walking them; they only grow with the number of distinct clusters.
+     ************************************************************************************
+     * Methods:
+     ************************************************************************************
+     * 1. Use find() to lookup the aerospike_ref for a cluster id without locking.
+     * 2. Use insert_if_absent() to publish an aerospike_ref for a cluster id. If
+     * another thread has already published one, that entry is returned instead
+     * and the caller should use it.
+     * 3. Use clear() on module shutdown to release all the published entries
+     * through the given release callback and free all the snapshots.
+     ************************************************************************************
+     */
+    class ConnectionRegistry {
+        public:
+            typedef std::unordered_map<uint64_t, aerospike_ref *> cluster_map;
+            typedef void (*release_callback)(aerospike_ref *ref_p);
+
+            ConnectionRegistry();
+            ~ConnectionRegistry();
+
+            aerospike_ref* find(uint64_t cluster_id) const;
+            aerospike_ref* insert_if_absent(uint64_t cluster_id,
+                    aerospike_ref *ref_p, bool& inserted);
+            void clear(release_callback release);
+
+        private:
+            static const uint32_t CONNECTION_REGISTRY_SHARDS = 16;
+
+            struct shard {
+                std::atomic<const cluster_map *>  snapshot;
+                std::mutex                      writer_mutex;
+                std::vector<const cluster_map *>  retired;
+            };
+
+            shard   shards[CONNECTION_REGISTRY_SHARDS];
+
+            shard& shard_for(uint64_t cluster_id);
+            const shard& shard_for(uint64_t cluster_id) const;
+    };
+
+    extern ConnectionRegistry persistent_list;
+} // namespace HPHP
+#endif /* end of __CONNECTION_REGISTRY_H__ */
@@ -9,6 +9,7 @@ extern "C" {
 #include "aerospike/as_error.h"
 #include "aerospike/aerospike_index.h"
 #include "aerospike/as_operations.h"
+#include "aerospike/as_bytes.h"
 }
 namespace HPHP {
     #define MAX_SIZE_OF_CONSTANT_NAME 512
@@ -34,7 +35,14 @@ namespace HPHP {
         OPT_POLICY_REPLICA,       /* set to one of Aerospike::POLICY_REPLICA_* */
         OPT_POLICY_CONSISTENCY,   /* set to one of Aerospike::POLICY_CONSISTENCY_* */
         OPT_POLICY_COMMIT_LEVEL,  /* set to one of Aerospike::POLICY_COMMIT_LEVEL_* */
-        OPT_TTL                   /* set to time-to-live of the record in seconds */
+        OPT_TTL,                  /* set to time-to-live of the record in seconds */
+        OPT_CONNECT_LAZY,         /* boolean value, default: false */
+        OPT_BOOLEAN_BINS,         /* array of bin names to be read back as booleans */
+        OPT_LAZY_RECORD,          /* boolean value, default: false */
+        OPT_COLLECTIONS,          /* boolean value, default: false */
+        OPT_POSITIONAL_RESULTS,   /* boolean value, default: false */
+        OPT_STREAM_CHUNK_SIZE,    /* integer value, default: 0 */
+        OPT_DECODE_JSON           /* boolean value, default: false */
     };
 
     /*
@@ -46,12 +54,29 @@ namespace HPHP {
     enum Aerospike_serializer_values {
         SERIALIZER_NONE,
         SERIALIZER_PHP,                                     /* default handler for serializer type */
-        SERIALIZER_JSON,
+        SERIALIZER_JSON,                                    /* native JSON serializer */
         SERIALIZER_USER,
+        SERIALIZER_BINARY,                                  /* native binary serializer */
     };
 
     #define SERIALIZER_DEFAULT "1"
 
+    /*
+     *******************************************************************************************************
+     * as_bytes types of the values serialized by the extension's native
+     * serializers. The binary serialized values are stored with the PHP
+     * clients' own type, AS_BYTES_PHP, and told apart from the values of the
+     * PHP serializer by their magic header, which serialize() never writes
+     * first. The JSON serialized values are plain JSON text stored as
+     * AS_BYTES_BLOB, so that other clients can read them. The compressed
+     * values start with the binary magic header too, flagged as compressed,
+     * so they need no type of their own.
+     *******************************************************************************************************
+     */
+    enum Aerospike_bytes_types {
+        AS_BYTES_HHVM_BINARY = AS_BYTES_PHP,
+    };
+
     /* 
      *******************************************************************************************************
      * Structure to map constant number to constant name string for Aerospike extension constants.
@@ -5,6 +5,12 @@
 #include "hphp/runtime/base/execution-context.h"
 #include "hphp/runtime/vm/native-data.h"
 #include "hphp/runtime/base/builtin-functions.h"
+#include "hphp/runtime/ext/collections/ext_collections-idl.h"
+#include "hphp/runtime/base/static-string-table.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 extern "C" {
 #include "aerospike/aerospike_key.h"
@@ -14,76 +20,269 @@ extern "C" {
 #include "aerospike/as_arraylist.h"
 #include "aerospike/as_map.h"
 #include "aerospike/as_hashmap.h"
+#include "aerospike/as_double.h"
+#include "aerospike/as_pair.h"
 }
 
 
 namespace HPHP {
     class StaticPoolManager;
+    class BinNameTable;
     /*
      *************************************************************************************************
      * Declaration of functions in conversions.cpp
      *************************************************************************************************
      */
     extern as_status php_config_to_as_config(const Array& php_config, as_config& config, as_error& error);
+    extern as_status ini_cluster_to_as_config(char *cluster_p, as_config& config, as_error& error);
+    extern uint64_t get_cluster_id(const as_config& config);
+    extern void create_cluster_alias(const as_config& config, std::string& cluster_alias);
+    extern bool is_same_cluster(const as_config& config, const std::string& cluster_alias);
     extern as_status php_key_to_as_key(const Array& php_key, as_key& key, as_error& error);
     extern as_status php_record_to_as_record(const Array& php_record, as_record& record, int64_t ttl, StaticPoolManager& static_pool, int16_t serializer_type, as_error& error);
     extern as_status php_variant_to_as_val(const Variant& php_variant, as_val **val_pp, StaticPoolManager& static_pool, int16_t serializer_type, as_error& error);
     extern as_status php_list_to_as_list(const Array& php_list, as_list **list_pp, StaticPoolManager& static_pool, int16_t serializer_type, as_error& error);
     extern as_status php_map_to_as_map(const Array& php_map, as_map **map_pp, StaticPoolManager& static_pool, int16_t serializer_type, as_error& error);
     extern as_status php_operations_to_as_operations(const Array& php_operations, as_operations& operations, StaticPoolManager& static_pool, int16_t serializer_type, as_error& error);
-    extern as_status as_record_to_php_record(const as_record *record_p, const as_key *key_p, Array& php_rec, as_policy_key *key_policy_p, as_error& error);
+    extern as_status as_record_to_php_record(const as_record *record_p, const as_key *key_p, Array& php_rec, as_policy_key *key_policy_p, as_error& error, BinNameTable *bin_names_p = NULL);
     extern as_status as_val_to_php_variant(const as_val *value_p, Variant& php_value, as_error& error);
     extern as_status as_list_to_php_list(const as_list *list_p, Variant& php_list, as_error& error);
     extern as_status as_map_to_php_map(const as_map *map_p, Variant& php_map, as_error& error);
-    extern as_status bins_to_php_bins(const as_record *record_p, Array& php_bins, as_error& error);
+    extern as_status bins_to_php_bins(const as_record *record_p, Array& php_bins, as_error& error, BinNameTable *bin_names_p = NULL);
+    extern as_status as_key_to_php_key(const as_key *key_p, Array& php_key, as_policy_key *key_policy_p, as_error& error);
     extern as_status metadata_to_php_metadata(const as_record *record_p, Array& php_metadata, as_error& error);
+    extern as_status get_boolean_bins_hint(const Variant& options, Array& boolean_bins, as_error& error);
+    extern void apply_boolean_bins_hint(const Array& boolean_bins, Array& php_record);
+    extern void apply_boolean_bins_hint_to_records(const Array& boolean_bins, Array& php_records);
+    extern bool is_collections_requested(const Variant& options);
+    extern bool is_decode_json_requested(const Variant& options);
 
     static const int PHP_KEY_SIZE = 3;
 
     /*
      **************************************************************************************************
-     * Class to manage a static pool of as_string, as_integer, as_arraylist, as_hashmap for use in
+     * Class to manage a chunked pool of fixed size elements (one as_* type).
+     * Chunks are malloc'd on demand, starting at FIRST_CHUNK_SIZE elements and
+     * doubling up to MAX_CHUNK_SIZE elements per chunk, so that handed out
+     * elements never move and the pool never runs out of elements.
+     * Chunks are zeroed when allocated, so that elements can keep state (for
+     * example recycled storage) across resets.
+     * Use reset() to rewind the pool, keeping its chunks for reuse. Use
+     * release() to visit every element ever handed out before the chunks are
+     * freed in bulk by the destructor.
+     **************************************************************************************************
+     */
+    class ChunkedPool {
+        private:
+            static const uint32_t       FIRST_CHUNK_SIZE = 16;
+            static const uint32_t       MAX_CHUNK_SIZE = 1024;
+
+            struct chunk {
+                void                    *elements;
+                uint32_t                capacity;
+            };
+
+            std::vector<chunk>          chunks;
+            size_t                      element_size;
+            uint32_t                    chunk_index = 0;
+            uint32_t                    element_index = 0;
+
+        public:
+            typedef void (*destroy_callback)(void *element_p);
+
+            explicit ChunkedPool(size_t element_size);
+            void* get();
+            void reset(destroy_callback destroy);
+            void release(destroy_callback release_element);
+            ~ChunkedPool();
+    };
+
+    /*
+     **************************************************************************************************
+     * Class to manage a pool of as_string, as_integer, as_double, as_arraylist, as_hashmap, as_bytes for use in
      * the flow of conversions.
-     * Instantiate this class and invoke methods to make use of stack allocated
+     * Instantiate this class and invoke methods to make use of pooled
      * as_* datatypes in order to avoid mallocs via use of as_*_new() APIs.
+     * Each type is kept in a ChunkedPool, so the pool grows with the size of
+     * the converted values, and costs nothing until used.
+     * The as_arraylist element storage is owned by the pool and recycled
+     * across resets.
+     * Use pin_string() to keep a PHP string alive until the next reset(), so
+     * that as_string/as_bytes can wrap its buffer without copying it.
+     * Use reset() to destroy all the used as_* and reuse the pool.
+     * Use StaticPoolScope to borrow the pool of the current thread instead of
+     * instantiating one.
      **************************************************************************************************
      */
 
     class StaticPoolManager {
         private:
-            static const uint32_t       STATIC_POOL_MAX_SIZE = 1024;
-            as_string                   string_pool[STATIC_POOL_MAX_SIZE];
-            as_integer                  integer_pool[STATIC_POOL_MAX_SIZE];
-            as_arraylist                list_pool[STATIC_POOL_MAX_SIZE];
-            as_hashmap                  map_pool[STATIC_POOL_MAX_SIZE];
-            as_bytes                    bytes_pool[STATIC_POOL_MAX_SIZE];
-            uint32_t                    string_pool_index = 0;
-            uint32_t                    integer_pool_index = 0;
-            uint32_t                    list_pool_index = 0;
-            uint32_t                    map_pool_index = 0;
-            uint32_t                    bytes_pool_index = 0;
+            /*
+             * An as_arraylist along with the element storage recycled for it
+             */
+            struct pooled_arraylist {
+                as_arraylist            list;
+                as_val                  **storage;
+                uint32_t                storage_capacity;
+            };
+
+            ChunkedPool                 string_pool{sizeof(as_string)};
+            ChunkedPool                 integer_pool{sizeof(as_integer)};
+            ChunkedPool                 double_pool{sizeof(as_double)};
+            ChunkedPool                 list_pool{sizeof(pooled_arraylist)};
+            ChunkedPool                 map_pool{sizeof(as_hashmap)};
+            ChunkedPool                 bytes_pool{sizeof(as_bytes)};
+
+            std::vector<String>         pinned_strings;
+
+            static void destroy_pooled_arraylist(void *element_p);
+            static void release_pooled_arraylist(void *element_p);
 
         public:
             StaticPoolManager();
             as_string* get_as_string();
             as_integer* get_as_integer();
-            as_arraylist* get_as_arraylist();
+            as_double* get_as_double();
+            as_arraylist* get_as_arraylist(uint32_t capacity);
             as_hashmap* get_as_hashmap();
             as_bytes* get_as_bytes();
+            const String& pin_string(const String& php_string);
+            void reset();
             ~StaticPoolManager();
     };
 
+    /*
+     **************************************************************************************************
+     * Class to borrow the StaticPoolManager of the current HHVM thread for the
+     * lifetime of the scope. The pool is reset when the scope ends, keeping its
+     * memory, so that steady state conversions do close to no malloc/free.
+     * If the thread's pool is already borrowed (for example by a conversion
+     * re-entering the extension through a user serializer), the scope falls
+     * back to a pool of its own.
+     **************************************************************************************************
+     */
+    class StaticPoolScope {
+        private:
+            static thread_local StaticPoolManager   thread_pool;
+            static thread_local bool                is_thread_pool_in_use;
+            StaticPoolManager                       *pool_p;
+
+        public:
+            StaticPoolScope();
+            StaticPoolManager& get() { return *pool_p; }
+            ~StaticPoolScope();
+    };
+
+    /*
+     **************************************************************************************************
+     * Class to intern the bin names of the records converted by a single
+     * operation (scan, query or batch read), so that the bins arrays of all the
+     * records share one PHP string per bin name, instead of allocating a
+     * string per bin of every record.
+     * The strings are static strings, shared by the whole process, since scan
+     * and query records are converted on C client threads, each with its own
+     * request heap, while the table is destroyed on the request thread.
+     * Bin names fit in the small string buffer of std::string, so a lookup does
+     * not allocate either.
+     **************************************************************************************************
+     */
+    class BinNameTable {
+        private:
+            std::unordered_map<std::string, String>     bin_names;
+
+        public:
+            const String& intern(const char *bin_name_p);
+    };
+
+    /*
+     **************************************************************************************************
+     * Class to have the lists and maps read within the lifetime of the scope
+     * converted into HH\Vector and HH\Map collections instead of PHP arrays,
+     * as requested by OPT_COLLECTIONS. The bins of a record are still returned
+     * as an array. Scopes nest, restoring the enclosing setting when they end.
+     **************************************************************************************************
+     */
+    class CollectionsScope {
+        private:
+            static thread_local bool    is_requested;
+            bool                        was_requested;
+
+        public:
+            explicit CollectionsScope(bool requested);
+            static bool requested() { return is_requested; }
+            ~CollectionsScope();
+    };
+
+    /*
+     **************************************************************************************************
+     * Class to have the AS_BYTES_BLOB values read within the lifetime of the
+     * scope decoded as the JSON text of SERIALIZER_JSON, as requested by
+     * OPT_DECODE_JSON, instead of being passed to the registered deserializer.
+     * Scopes nest, restoring the enclosing setting when they end.
+     **************************************************************************************************
+     */
+    class DecodeJsonScope {
+        private:
+            static thread_local bool    is_requested;
+            bool                        was_requested;
+
+        public:
+            explicit DecodeJsonScope(bool requested);
+            static bool requested() { return is_requested; }
+            ~DecodeJsonScope();
+    };
+
+    /*
+     **************************************************************************************************
+     * Class to deserialize the user serialized (AS_BYTES_BLOB) bins of a record,
+     * or of all the records of a batch read, with a single call to the
+     * deserializer registered by Aerospike::setBatchDeserializer().
+     * Add the records and invoke deserialize(), then the conversion of their
+     * bins finds the deserialized values instead of calling the deserializer
+     * per bin. Batches nest for the lifetime of their scope, so that a record
+     * whose blobs are already deserialized by an enclosing batch is not
+     * deserialized again.
+     * Does nothing unless a batched deserializer is registered.
+     **************************************************************************************************
+     */
+    class DeserializerBatch {
+        private:
+            static thread_local DeserializerBatch       *current_p;
+            DeserializerBatch                           *previous_p;
+            std::unordered_map<const as_bytes *, int64_t> indexes;
+            Array                                       blobs;
+            Array                                       values;
+
+            bool contains(const as_bytes *bytes_p) const;
+
+        public:
+            DeserializerBatch();
+            void add_bytes(const as_bytes *bytes_p);
+            void add_record(const as_record *record_p);
+            as_status deserialize(as_error& error);
+            static bool find(const as_bytes *bytes_p, Variant& php_value);
+            ~DeserializerBatch();
+    };
+
     /*
      ************************************************************************************
      * Structure declaration for foreach_callback_udata.
      * Holds the 'data' to be populated by the callback, and 'error' to be
-     * populated in case of errors.
+     * populated in case of errors. Optionally holds the 'bin_names_p' table to
+     * intern the bin names of the converted records, whether records are
+     * converted into Aerospike\Record objects, and whether the results are
+     * appended in the order of the batch instead of set by key.
      ************************************************************************************
      */
     typedef struct __foreach_callback_udata {
         Array& data;
         as_error& error;
-        __foreach_callback_udata(Array &init_data, as_error& init_error) : data(init_data), error(init_error) {}
+        BinNameTable *bin_names_p;
+        bool is_lazy_record = false;
+        bool is_positional = false;
+        __foreach_callback_udata(Array &init_data, as_error& init_error,
+                BinNameTable *init_bin_names_p = NULL) : data(init_data), error(init_error),
+                bin_names_p(init_bin_names_p) {}
     } foreach_callback_udata;
 } // namespace HPHP
 #endif /* end of __CONVERSIONS_H__ */
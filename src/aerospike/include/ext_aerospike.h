@@ -12,14 +12,21 @@ extern "C" {
 #include "stdlib.h"
 }
 
+#include <atomic>
+#include <string>
+#include <vector>
+
 #include "constants.h"
 
 namespace HPHP {
 #define MAX_PORT_SIZE 6
+#define DEFAULT_PORT 3000
 
     /*
      *******************************************************************************************************
      * Structure containing C client's aerospike object and its reference counter.
+     * The reference counters are atomic, since the same aerospike_ref is
+     * shared by all the request threads through the persistent_list.
      *******************************************************************************************************
      */
     typedef struct csdk_aerospike_object {
@@ -33,14 +40,38 @@ namespace HPHP {
          * SDK aerospike object being held by the various PHP userland Aerospike
          * objects.
          */
-        int ref_php_object;
+        std::atomic<int> ref_php_object;
 
         /*
          * ref_hosts_entry indicates the no. of references for internal C
          * SDK aerospike object being held by entries in aerospike global
-         * persistent_list hashtable.
+         * persistent_list registry.
+         */
+        std::atomic<int> ref_host_entry;
+
+        /*
+         * cluster_alias holds the canonical "addr:port;...user" of the
+         * cluster, used to tell apart clusters whose cluster id collide.
          */
-        int ref_host_entry;
+        std::string cluster_alias;
+
+        /*
+         * instances holds the C client instances kept for the cluster as per
+         * aerospike.connection.instances. It is only populated on the entry
+         * published in the persistent_list, instances[0] being that entry.
+         * Every instance points back to that entry through primary_p.
+         */
+        std::vector<csdk_aerospike_object *> instances;
+        csdk_aerospike_object *primary_p;
+
+        /*
+         * bind_count indicates the no. of PHP userland Aerospike objects ever
+         * bound to this C SDK aerospike object.
+         */
+        std::atomic<uint64_t> bind_count;
+
+        csdk_aerospike_object() : as_p(NULL), ref_php_object(0), ref_host_entry(0),
+            primary_p(this), bind_count(0) {}
     } aerospike_ref;
 
     /*
@@ -72,10 +103,16 @@ namespace HPHP {
     const StaticString s_udf_module_name("name");
     const StaticString s_udf_module_type("type");
     const StaticString s_shm("shm");
+    const StaticString s_instance("instance");
+    const StaticString s_php_objects("php_objects");
+    const StaticString s_bound("bound");
+    const StaticString s_current("current");
     const StaticString s_shm_key("shm_key");
     const StaticString s_shm_max_nodes("shm_max_nodes");
     const StaticString s_shm_max_namespaces("shm_max_namespaces");
     const StaticString s_shm_takeover_threshold_sec("shm_takeover_threshold_sec");
+    const StaticString s_HH_Vector("HH\\Vector");
+    const StaticString s_HH_Map("HH\\Map");
     
     /*
      ************************************************************************************
@@ -84,6 +121,7 @@ namespace HPHP {
      * 2. latest instance level error
      * 3. is_connected flag
      * 4. ref_count for the Aerospike C client's connection object reference
+     * 5. config and options of a connection deferred by OPT_CONNECT_LAZY
      ************************************************************************************
      */
     class Aerospike {
@@ -92,24 +130,36 @@ namespace HPHP {
             bool is_connected = false;
             bool is_persistent = false;
             int16_t serializer_value = SERIALIZER_PHP;
+            bool is_connect_deferred = false;
+            Variant deferred_config;
+            Variant deferred_options;
+            /*
+             * The Aerospike object is request local, so the latest error needs
+             * no locking. latest_error is only populated on failure, see
+             * set_latest_error().
+             */
+            as_status latest_error_code = AEROSPIKE_OK;
             as_error latest_error;
-            pthread_rwlock_t latest_error_mutex;
 
             //static ObjectData* serializer;
             static Variant serializer;
             static Variant deserializer;
             static int is_serializer_registered;
             static int is_deserializer_registered;
+            static int is_deserializer_batched;
 
             Aerospike();
             void sweep();
+            void set_latest_error(const as_error& error);
             ~Aerospike();
 
             as_status configure_connection(as_config& config, as_error& error);
+            as_status connect_to_cluster(const Array& php_config,
+                    const Variant& options, as_error& error);
+            as_status connect_deferred(as_error& error);
 
         private:
             void create_new_host_entry(as_config& config, as_error& error);
-            void iterate_hosts_add_entry(as_config& config, int matched_host_id);
     };
 
 } // namespace HPHP
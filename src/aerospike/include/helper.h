@@ -5,6 +5,8 @@
 #include "hphp/runtime/base/execution-context.h"
 #include "hphp/runtime/vm/native-data.h"
 
+#include <functional>
+
 extern "C" {
 #include "aerospike/aerospike_key.h"
 #include "aerospike/as_status.h"
@@ -22,5 +24,7 @@ namespace HPHP {
     extern as_status aerospike_get_filtered_bins(const Array& php_filter_bins,
             aerospike *as_p, as_policy_read *read_policy_p, as_key& key,
             as_record **record_pp, as_error& error);
+    extern void run_concurrently(uint32_t count, int64_t concurrency,
+            const std::function<void(uint32_t)>& job);
 } // namespace HPHP
 #endif /* end of __HELPER_H__ */
@@ -0,0 +1,65 @@
+#ifndef __LAZY_RECORD_H__
+#define __LAZY_RECORD_H__
+
+#include "hphp/runtime/ext/extension.h"
+#include "hphp/runtime/base/execution-context.h"
+#include "hphp/runtime/vm/native-data.h"
+
+extern "C" {
+#include "aerospike/aerospike_key.h"
+#include "aerospike/as_status.h"
+#include "aerospike/as_record.h"
+}
+
+namespace HPHP {
+    const StaticString s_AerospikeRecord("AerospikeRecord");
+    const StaticString s_AerospikeRecordClass("Aerospike\\Record");
+
+    /*
+     ************************************************************************************
+     * AerospikeRecord class, the native data of the Aerospike\Record PHP
+     * class, returned instead of record arrays when OPT_LAZY_RECORD is set.
+     * It holds the C client's as_record and converts a bin into a PHP value only
+     * when the bin is accessed, caching the converted value. The key and
+     * metadata are converted upfront, since they are small.
+     * The OPT_COLLECTIONS, OPT_DECODE_JSON and OPT_BOOLEAN_BINS hints of the
+     * read are kept along with the as_record, and applied when a bin is
+     * converted.
+     * Bins set or unset through ArrayAccess override the bins of the
+     * as_record.
+     ************************************************************************************
+     */
+    class AerospikeRecord {
+        public:
+            as_record *record_p{nullptr};
+            Array php_key;
+            Array php_metadata;
+            Array decoded_bins;
+            Array unset_bins;
+            Array boolean_bins;
+            bool is_collections{false};
+            bool is_decode_json{false};
+
+            AerospikeRecord();
+            AerospikeRecord& operator=(const AerospikeRecord& that);
+            void sweep();
+            ~AerospikeRecord();
+
+            bool has_bin(const Variant& bin_name);
+            Variant get_bin(const Variant& bin_name);
+            Array get_bins();
+    };
+
+    /*
+     *************************************************************************************************
+     * Declaration of functions in lazy_record.cpp
+     *************************************************************************************************
+     */
+    extern bool is_lazy_record_requested(const Variant& options);
+    extern as_status as_record_to_lazy_record(as_record *record_p, const as_key *key_p,
+            Variant& php_record, as_policy_key *key_policy_p, bool adopt_record, as_error& error);
+    extern void apply_boolean_bins_hint_to_lazy_record(const Array& boolean_bins,
+            const Variant& php_record);
+    extern void register_lazy_record_class();
+} // namespace HPHP
+#endif /* end of __LAZY_RECORD_H__ */
@@ -36,6 +36,15 @@ namespace HPHP {
         int64_t     shm_takeover_threshold_sec;
         std::string lua_system_path;
         std::string lua_user_path;
+        std::string prewarm_clusters;
+        int64_t     connection_instances;
+        bool        zero_copy_writes;
+        bool        native_doubles;
+        bool        native_booleans;
+        int64_t     compression_threshold;
+        int64_t     batch_concurrency;
+        int64_t     batch_max_keys;
+        int64_t     worker_threads;
     };
 
     extern struct ini_entries ini_entry;
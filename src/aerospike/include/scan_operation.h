@@ -4,6 +4,7 @@
 #include "hphp/runtime/ext/extension.h"
 #include "hphp/runtime/base/execution-context.h"
 #include "hphp/runtime/vm/native-data.h"
+#include "conversions.h"
 
 extern "C" {
 #include "aerospike/as_status.h"
@@ -58,13 +59,20 @@ namespace HPHP {
     /*
      ************************************************************************************
      * Structure declaration for foreach_callback_user_udata.
-     * Holds the 'function' to be populated by the callback, and 'error' to be
-     * populated in case of errors.
+     * Holds the 'function' to be populated by the callback, 'error' to be
+     * populated in case of errors, the 'bin_names' of the records passed
+     * to the function, whether the records are passed as Aerospike\Record
+     * objects, whether their lists and maps are passed as collections, and
+     * whether their blobs are decoded as JSON.
      ************************************************************************************
      */
     typedef struct __foreach_callback_user_udata {
         const Variant& function;
         as_error& error;
+        BinNameTable bin_names;
+        bool is_lazy_record = false;
+        bool is_collections = false;
+        bool is_decode_json = false;
         __foreach_callback_user_udata(const Variant &init_data, as_error& init_error) : function(init_data), error(init_error) {}
     } foreach_callback_user_udata;
 } //namespace HPHP
@@ -0,0 +1,112 @@
+#ifndef __SERIALIZERS_H__
+#define __SERIALIZERS_H__
+
+#include "hphp/runtime/ext/extension.h"
+
+extern "C" {
+#include "aerospike/as_status.h"
+#include "aerospike/as_error.h"
+}
+
+namespace HPHP {
+    /*
+     *************************************************************************************************
+     * Format of the values serialized by the native binary serializer
+     * (SERIALIZER_BINARY), stored as AS_BYTES_HHVM_BINARY (AS_BYTES_PHP).
+     *
+     * A serialized value is the BINARY_MAGIC and BINARY_VERSION bytes followed
+     * by the tagged value. serialize() never writes BINARY_MAGIC first, so it
+     * tells these values apart from the ones of the PHP serializer.
+     * Integers take a single byte up to 127, and otherwise the least of 1, 2,
+     * 4 or 8 bytes. Lengths and counts are unsigned LEB128 varints. Fixed
+     * size values are little endian.
+     * Strings of up to BINARY_STRING_DEDUP_MAX_LEN bytes are numbered in the
+     * order they are first written, and written again as a reference to their
+     * number, so that the keys repeated across the elements of a list of
+     * arrays are stored once.
+     * Arrays with the keys 0..n-1 are written as lists of values. stdClass
+     * objects are written as their properties. Other objects are written
+     * using the PHP serializer, since they may define how they are serialized.
+     *************************************************************************************************
+     */
+    enum binary_serializer_tags {
+        BINARY_TAG_NULL         = 0x00,
+        BINARY_TAG_FALSE        = 0x01,
+        BINARY_TAG_TRUE         = 0x02,
+        BINARY_TAG_INT8         = 0x03,
+        BINARY_TAG_INT16        = 0x04,
+        BINARY_TAG_INT32        = 0x05,
+        BINARY_TAG_INT64        = 0x06,
+        BINARY_TAG_DOUBLE       = 0x07,
+        BINARY_TAG_STRING       = 0x08,     /* varint length, bytes */
+        BINARY_TAG_STRING_REF   = 0x09,     /* varint string number */
+        BINARY_TAG_ARRAY        = 0x0A,     /* varint count, count * (key, value) */
+        BINARY_TAG_LIST         = 0x0B,     /* varint count, count * value */
+        BINARY_TAG_STDCLASS     = 0x0C,     /* varint count, count * (name, value) */
+        BINARY_TAG_SERIALIZED   = 0x0D,     /* varint length, PHP serialized object */
+        BINARY_TAG_FIXINT       = 0x80      /* 0x80 | integer, for 0..127 */
+    };
+
+    static const uint8_t    BINARY_MAGIC = 0xA5;
+    static const uint8_t    BINARY_VERSION = 0x01;
+    static const uint8_t    BINARY_FLAG_COMPRESSED = 0x80;
+    static const uint32_t   BINARY_STRING_DEDUP_MAX_LEN = 64;
+
+    /*
+     *************************************************************************************************
+     * Format of the values serialized by the native JSON serializer
+     * (SERIALIZER_JSON), stored as AS_BYTES_BLOB.
+     *
+     * A serialized value is plain JSON text, without any header, so that
+     * services using other clients can read it. It is encoded and decoded in
+     * a single pass without going through json_encode()/json_decode(). Blobs
+     * are only decoded as JSON when the read sets OPT_DECODE_JSON, since they
+     * may as well hold the values of a user serializer.
+     * Arrays with the keys 0..n-1 are written as JSON arrays, and other arrays,
+     * stdClass objects and the public properties of other objects as JSON
+     * objects. Strings must be valid UTF-8, and floats finite. JSON objects
+     * are read back as stdClass objects, as json_decode() does by default.
+     * Numbers without a fraction or an exponent that fit an integer are read
+     * back as integers, and others as floats.
+     *************************************************************************************************
+     */
+    static const uint32_t   JSON_NUMBER_MAX_LEN = 64;
+
+    /*
+     *************************************************************************************************
+     * Format of the serialized values compressed when they are at least
+     * aerospike.compression_threshold bytes, stored as AS_BYTES_PHP like the
+     * values they compress.
+     *
+     * A compressed value is the BINARY_MAGIC byte, the BINARY_VERSION byte
+     * with the BINARY_FLAG_COMPRESSED flag set, the size of the serialized
+     * value as 4 little endian bytes, and the zlib stream of its bytes. The
+     * serialized value is itself a PHP or a binary serialized value.
+     * Values which do not get smaller are stored uncompressed, and values
+     * larger than COMPRESSED_MAX_SIZE, the largest record the server
+     * accepts, are never compressed, so that reading a corrupt value never
+     * allocates more than that.
+     *************************************************************************************************
+     */
+    static const uint32_t   COMPRESSED_HEADER_SIZE = 6;
+    static const uint32_t   COMPRESSED_MAX_SIZE = 8 * 1024 * 1024;
+
+    /*
+     *************************************************************************************************
+     * Declaration of functions in serializers.cpp
+     *************************************************************************************************
+     */
+    extern as_status binary_serialize(const Variant& php_value, String& serialized_string,
+            as_error& error);
+    extern as_status binary_unserialize(const uint8_t *bytes_p, uint32_t size,
+            Variant& php_value, as_error& error);
+    extern as_status json_serialize(const Variant& php_value, String& serialized_string,
+            as_error& error);
+    extern as_status json_unserialize(const uint8_t *bytes_p, uint32_t size,
+            Variant& php_value, as_error& error);
+    extern bool compress_serialized(const String& serialized_string, String& compressed_string);
+    extern bool is_compressed_serialized(const uint8_t *bytes_p, uint32_t size);
+    extern as_status decompress_serialized(const uint8_t *bytes_p, uint32_t size,
+            String& serialized_string, as_error& error);
+} // namespace HPHP
+#endif /* end of __SERIALIZERS_H__ */
@@ -1,6 +1,13 @@
 #include "batch_op_manager.h"
 #include "conversions.h"
 #include "helper.h"
+#include "lazy_record.h"
+#include "constants.h"
+#include "policy.h"
+
+#include "hphp/runtime/base/packed-array.h"
+
+#include <algorithm>
 
 namespace HPHP {
 
@@ -22,7 +29,7 @@ namespace HPHP {
      */
     BatchOpManager::BatchOpManager(const Array& php_keys)
     {
-        uint16_t batch_iter = 0;
+        uint32_t batch_iter = 0;
         std::exception e;
 
         as_batch_init(&this->batch, php_keys.size());
@@ -55,7 +62,7 @@ namespace HPHP {
      *                              to be populated with the current value
      *                              (inner_meta_array) using the key_p as the
      *                              current key.
-     * @param inner_meta_array      PHP Array reference to the inner_meta_array
+     * @param inner_meta_array      PHP Variant reference to the inner_meta_array
      *                              which is the current value to be populated
      *                              within the outer_meta_array.
      * @param error                 as_error reference to be populated by this
@@ -63,7 +70,7 @@ namespace HPHP {
      *******************************************************************************************
      */
     void BatchOpManager::populate_result_for_get_exists_many(as_key *key_p,
-            Array& outer_meta_array, Array& inner_meta_array,
+            Array& outer_meta_array, const Variant& inner_meta_array,
             as_error& error)
     {
         as_error_reset(&error);
@@ -89,6 +96,60 @@ namespace HPHP {
         }
     }
 
+    /*
+     *******************************************************************************************
+     * Private member function that resets the result of a positional batch
+     * operation to a packed array reserved for the number of keys, since
+     * the C client passes the results in the order of the keys.
+     *
+     * @param php_result            PHP Array reference to the result to be
+     *                              reset.
+     *******************************************************************************************
+     */
+    void BatchOpManager::init_positional_result(Array& php_result)
+    {
+        php_result = Array::attach(PackedArray::MakeReserve(this->batch.keys.size));
+    }
+
+    /*
+     *******************************************************************************************
+     * Private member function that converts the result of a batch read for
+     * one key into a PHP record, or NULL if the record was not found.
+     *
+     * @param result_p              as_batch_read pointer to the result of the key.
+     * @param record                PHP Variant reference to be set to the PHP
+     *                              record.
+     * @param bin_names_p           The table to intern the bin names with.
+     * @param is_lazy_record        If true, the record is converted into an
+     *                              Aerospike\Record object.
+     * @param error                 as_error reference to be populated by this
+     *                              method in case of error.
+     *
+     * @return AEROSPIKE_OK if SUCCESS. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status BatchOpManager::batch_read_to_php_record(const as_batch_read *result_p,
+            Variant& record, BinNameTable *bin_names_p, bool is_lazy_record,
+            as_error& error)
+    {
+        as_error_reset(&error);
+
+        record = init_null();
+        if (result_p->result != AEROSPIKE_OK) {
+            return error.code;
+        }
+        if (is_lazy_record) {
+            as_record_to_lazy_record((as_record *) &result_p->record,
+                    (as_key *) result_p->key, record, NULL, false, error);
+        } else {
+            Array php_record = Array::Create();
+            as_record_to_php_record(&result_p->record, (as_key *) result_p->key,
+                    php_record, NULL, error, bin_names_p);
+            record = php_record;
+        }
+        return error.code;
+    }
+
     /*
      *******************************************************************************************
      * Private member function that is registered as the callback
@@ -105,7 +166,7 @@ namespace HPHP {
             uint32_t n, void* udata)
     {
         foreach_callback_udata *exists_cb_udata = (foreach_callback_udata *) udata;
-        uint16_t i = 0;
+        uint32_t i = 0;
         as_error_reset(&exists_cb_udata->error);
 
         for (i = 0; i < n; i++) {
@@ -123,8 +184,12 @@ namespace HPHP {
                     return false;
                 }
             }
-            BatchOpManager::populate_result_for_get_exists_many((as_key *) results[i].key,
-                    exists_cb_udata->data, metadata, exists_cb_udata->error);
+            if (exists_cb_udata->is_positional) {
+                exists_cb_udata->data.append(metadata);
+            } else {
+                BatchOpManager::populate_result_for_get_exists_many((as_key *) results[i].key,
+                        exists_cb_udata->data, metadata, exists_cb_udata->error);
+            }
         }
         if (AEROSPIKE_OK != exists_cb_udata->error.code) {
             return false;
@@ -148,34 +213,260 @@ namespace HPHP {
             uint32_t n, void* udata)
     {
         foreach_callback_udata *get_cb_udata = (foreach_callback_udata *) udata;
-        uint16_t i = 0;
+        uint32_t i = 0;
+        DeserializerBatch deserializer_batch;
         as_error_reset(&get_cb_udata->error);
 
+        /*
+         * Deserialize the user serialized bins of all the records with a
+         * single call to a batched deserializer.
+         */
+        if (!get_cb_udata->is_lazy_record) {
+            for (i = 0; i < n; i++) {
+                if (results[i].result == AEROSPIKE_OK) {
+                    deserializer_batch.add_record(&results[i].record);
+                }
+            }
+            if (AEROSPIKE_OK != deserializer_batch.deserialize(get_cb_udata->error)) {
+                return false;
+            }
+        }
+
         for (i = 0; i < n; i++) {
             if (results[i].result != AEROSPIKE_OK &&
                     results[i].result != AEROSPIKE_ERR_RECORD_NOT_FOUND) {
                 return false;
             }
 
-            Array record;
-            if (results[i].result == AEROSPIKE_OK) {
-                record = Array::Create();
-                as_record_to_php_record(&results[i].record,
-                        (as_key *) results[i].key, record, NULL,
-                        get_cb_udata->error);
-                if (AEROSPIKE_OK != get_cb_udata->error.code) {
-                    return false;
-                }
+            Variant record;
+            if (AEROSPIKE_OK != batch_read_to_php_record(&results[i], record,
+                        get_cb_udata->bin_names_p, get_cb_udata->is_lazy_record,
+                        get_cb_udata->error)) {
+                return false;
+            }
+            if (get_cb_udata->is_positional) {
+                get_cb_udata->data.append(record);
+            } else {
+                BatchOpManager::populate_result_for_get_exists_many((as_key *) results[i].key,
+                        get_cb_udata->data, record, get_cb_udata->error);
             }
-            BatchOpManager::populate_result_for_get_exists_many((as_key *) results[i].key,
-                    get_cb_udata->data, record, get_cb_udata->error);
         }
         if (AEROSPIKE_OK != get_cb_udata->error.code) {
             return false;
         }
         return true;
     }
-    
+
+    /*
+     *******************************************************************************************
+     * Private member function that is registered as the callback
+     * for a streamed batch get, invoked by the C client.
+     * The records are converted and passed to the PHP function one by one, or
+     * a chunk at a time, so that only the records of the current call are
+     * held in PHP memory. Each record is passed along with the position of its
+     * key within the whole batch, NULL for the records not found.
+     *
+     * @param results               as_batch_read pointer that holds the batch results.
+     * @param n                     number of keys in the batch results.
+     * @param udata                 The batch_stream_udata passed to this callback.
+     * @return true if SUCCESS else false.
+     *******************************************************************************************
+     */
+    bool BatchOpManager::batch_get_stream_cb(const as_batch_read* results,
+            uint32_t n, void* udata)
+    {
+        batch_stream_udata *stream_udata_p = (batch_stream_udata *) udata;
+        uint32_t chunk_size = (stream_udata_p->chunk_size > 0) ?
+            (uint32_t) std::min<int64_t>(stream_udata_p->chunk_size, n) : 1;
+        as_error_reset(&stream_udata_p->error);
+
+        for (uint32_t start = 0; start < n && !stream_udata_p->is_stopped;
+                start += chunk_size) {
+            uint32_t end = std::min(n, start + chunk_size);
+            DeserializerBatch deserializer_batch;
+
+            if (!stream_udata_p->is_lazy_record) {
+                for (uint32_t i = start; i < end; i++) {
+                    if (results[i].result == AEROSPIKE_OK) {
+                        deserializer_batch.add_record(&results[i].record);
+                    }
+                }
+                if (AEROSPIKE_OK != deserializer_batch.deserialize(stream_udata_p->error)) {
+                    return false;
+                }
+            }
+
+            Array php_chunk = Array::Create();
+            for (uint32_t i = start; i < end; i++) {
+                if (results[i].result != AEROSPIKE_OK &&
+                        results[i].result != AEROSPIKE_ERR_RECORD_NOT_FOUND) {
+                    return false;
+                }
+
+                Variant record;
+                if (AEROSPIKE_OK != batch_read_to_php_record(&results[i], record,
+                            &stream_udata_p->bin_names, stream_udata_p->is_lazy_record,
+                            stream_udata_p->error)) {
+                    return false;
+                }
+                if (record.isArray()) {
+                    Array php_record = record.toArray();
+                    apply_boolean_bins_hint(stream_udata_p->boolean_bins, php_record);
+                    record = php_record;
+                } else {
+                    apply_boolean_bins_hint_to_lazy_record(stream_udata_p->boolean_bins,
+                            record);
+                }
+                php_chunk.set((int64_t) (results[i].key - stream_udata_p->first_key_p),
+                        record);
+            }
+
+            Variant ret;
+            if (stream_udata_p->chunk_size > 0) {
+                ret = vm_call_user_func(stream_udata_p->function,
+                        make_packed_array(php_chunk));
+            } else {
+                int64_t index = results[start].key - stream_udata_p->first_key_p;
+                ret = vm_call_user_func(stream_udata_p->function,
+                        make_packed_array(php_chunk[index], index));
+            }
+            if (ret.isBoolean() && ret.toBoolean() == false) {
+                stream_udata_p->is_stopped = true;
+            }
+        }
+        return true;
+    }
+
+    /*
+     *******************************************************************************************
+     * Private member function that is registered as the callback for the
+     * batch read of a chunk run by a worker thread, invoked by the C client.
+     * The results are kept in the batch_chunk, without any HHVM value, until
+     * they are passed to the callback of the operation on the request thread.
+     * The records share the bin values of the C client's records, which are
+     * destroyed when this callback returns.
+     *
+     * @param results               as_batch_read pointer that holds the batch results.
+     * @param n                     number of keys in the batch results.
+     * @param udata                 The batch_chunk of the results.
+     * @return true.
+     *******************************************************************************************
+     */
+    bool BatchOpManager::batch_collect_cb(const as_batch_read* results,
+            uint32_t n, void* udata)
+    {
+        batch_chunk *chunk_p = (batch_chunk *) udata;
+
+        chunk_p->results.resize(n);
+        for (uint32_t i = 0; i < n; i++) {
+            as_batch_read *result_p = &chunk_p->results[i];
+            const as_record *record_p = &results[i].record;
+
+            result_p->key = results[i].key;
+            result_p->result = results[i].result;
+            as_record_init(&result_p->record, record_p->bins.size);
+            result_p->record.gen = record_p->gen;
+            result_p->record.ttl = record_p->ttl;
+            for (uint16_t bin_iter = 0; bin_iter < record_p->bins.size; bin_iter++) {
+                as_bin *bin_p = &record_p->bins.entries[bin_iter];
+                as_val_reserve((as_val *) bin_p->valuep);
+                as_record_set(&result_p->record, bin_p->name, bin_p->valuep);
+            }
+        }
+        return true;
+    }
+
+    /*
+     *******************************************************************************************
+     * Private member function that runs a batch read of the keys, invoking
+     * the callback with the results in the order of the keys.
+     * Up to aerospike.batch_max_keys keys are read by a single command.
+     * Larger batches are split into chunks, which are read concurrently on
+     * up to aerospike.batch_concurrency threads, and whose results are passed
+     * to the callback chunk by chunk, on the request thread.
+     * If is_stopped_p is set, the chunks are read one after the other, until
+     * the callback sets it, so that results are passed as soon as they are
+     * read and no chunk is read in vain.
+     *
+     * @param command               The batch read to run for every chunk.
+     * @param callback              The callback of the operation.
+     * @param udata                 The userdata passed to the callback.
+     * @param error                 as_error reference to be populated by this
+     *                              method in case of error. Set to the error
+     *                              of the first chunk which failed.
+     * @param is_stopped_p          If not NULL, set to true to stop the batch.
+     *
+     * @return AEROSPIKE_OK if SUCCESS. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status BatchOpManager::execute_in_chunks(const batch_command& command,
+            aerospike_batch_read_callback callback, void *udata,
+            as_error& error, const bool *is_stopped_p)
+    {
+        uint32_t size = this->batch.keys.size;
+        uint32_t max_keys = (ini_entry.batch_max_keys > 0) ?
+            (uint32_t) std::min<int64_t>(ini_entry.batch_max_keys, UINT32_MAX) : size;
+
+        as_error_reset(&error);
+
+        if (size <= max_keys) {
+            command(&this->batch, callback, udata, error);
+            return error.code;
+        }
+
+        uint32_t chunk_count = (size + max_keys - 1) / max_keys;
+        std::vector<batch_chunk> chunks(chunk_count);
+        for (uint32_t chunk_iter = 0; chunk_iter < chunk_count; chunk_iter++) {
+            as_batch *chunk_batch_p = &chunks[chunk_iter].batch;
+            uint32_t start = chunk_iter * max_keys;
+
+            /*
+             * The chunks only point to the keys of the batch, they are never
+             * destroyed.
+             */
+            chunk_batch_p->_free = false;
+            chunk_batch_p->keys._free = false;
+            chunk_batch_p->keys.entries = as_batch_keyat(&this->batch, start);
+            chunk_batch_p->keys.size = std::min(max_keys, size - start);
+            as_error_init(&chunks[chunk_iter].error);
+        }
+
+        if (is_stopped_p || ini_entry.batch_concurrency <= 1) {
+            for (auto& chunk : chunks) {
+                command(&chunk.batch, callback, udata, error);
+                if (AEROSPIKE_OK != error.code || (is_stopped_p && *is_stopped_p)) {
+                    break;
+                }
+            }
+            return error.code;
+        }
+
+        run_concurrently(chunk_count, ini_entry.batch_concurrency,
+                [&](uint32_t chunk_iter) {
+            batch_chunk *chunk_p = &chunks[chunk_iter];
+            command(&chunk_p->batch, (aerospike_batch_read_callback) &batch_collect_cb,
+                    chunk_p, chunk_p->error);
+        });
+
+        for (auto& chunk : chunks) {
+            if (AEROSPIKE_OK != chunk.error.code) {
+                as_error_copy(&error, &chunk.error);
+                break;
+            }
+            if (!callback(chunk.results.data(), chunk.results.size(), udata) ||
+                    AEROSPIKE_OK != error.code) {
+                break;
+            }
+        }
+
+        for (auto& chunk : chunks) {
+            for (auto& result : chunk.results) {
+                as_record_destroy(&result.record);
+            }
+        }
+        return error.code;
+    }
+
     /*
      *******************************************************************************************
      * Public member function that is used to invoke a batch exists operation.
@@ -187,19 +478,28 @@ namespace HPHP {
      *                              operation.
      * @param error                 as_error reference to be populated by this
      *                              method in case of error.
+     * @param is_positional         If true, the metadata is returned as a list
+     *                              in the order of the keys.
      *
      * @return AEROSPIKE_OK if SUCCESS. Otherwise AEROSPIKE_ERR_*.
      *******************************************************************************************
      */
     as_status BatchOpManager::execute_batch_exists(aerospike *as_p,
             Array &php_metadata, as_policy_batch& batch_policy,
-            as_error& error)
+            as_error& error, bool is_positional)
     {
         as_error_reset(&error);
         foreach_callback_udata udata(php_metadata, error);
-        aerospike_batch_exists(as_p, &error, &batch_policy, &this->batch,
-                (aerospike_batch_read_callback) &batch_exists_cb, &udata);
-        return error.code;
+        udata.is_positional = is_positional;
+        if (is_positional) {
+            init_positional_result(php_metadata);
+        }
+        return execute_in_chunks([&](as_batch *batch_p,
+                    aerospike_batch_read_callback callback, void *udata_p,
+                    as_error& command_error) {
+                aerospike_batch_exists(as_p, &command_error, &batch_policy, batch_p,
+                        callback, udata_p);
+            }, (aerospike_batch_read_callback) &batch_exists_cb, &udata, error, NULL);
     }
     
     /*
@@ -215,6 +515,10 @@ namespace HPHP {
      *                              operation.
      * @param error                 as_error reference to be populated by this
      *                              method in case of error.
+     * @param is_lazy_record        If true, the records are returned as
+     *                              Aerospike\Record objects.
+     * @param is_positional         If true, the records are returned as a list
+     *                              in the order of the keys.
      *
      * @return AEROSPIKE_OK if SUCCESS. Otherwise AEROSPIKE_ERR_*.
      *******************************************************************************************
@@ -222,31 +526,166 @@ namespace HPHP {
     as_status BatchOpManager::execute_batch_get(aerospike *as_p,
             Array &php_records, const Variant& php_filter_bins,
             as_policy_batch& batch_policy,
-            as_error& error)
+            as_error& error, bool is_lazy_record, bool is_positional)
     {
+        BinNameTable            bin_names;
+
         as_error_reset(&error);
-        foreach_callback_udata udata(php_records, error);
+        foreach_callback_udata udata(php_records, error, &bin_names);
+        udata.is_lazy_record = is_lazy_record;
+        udata.is_positional = is_positional;
+        if (is_positional) {
+            init_positional_result(php_records);
+        }
 
+        return batch_get(as_p, php_filter_bins, batch_policy,
+                (aerospike_batch_read_callback) &batch_get_cb, &udata, error);
+    }
+
+    /*
+     *******************************************************************************************
+     * Public member function that is used to invoke a batch get operation
+     * which passes the records to a PHP function instead of returning them.
+     *
+     * @param as_p                  aerospike pointer for the current batch operation.
+     * @param function              The PHP function the records are passed to.
+     *                              It stops the operation by returning false.
+     * @param chunk_size            The number of records passed per call, as an
+     *                              array indexed by the position of their keys.
+     *                              If 0, the function is called per record, with
+     *                              the record and the position of its key.
+     * @param php_filter_bins       The optional php filter bins array used to
+     *                              select specific bins in the batch get.
+     * @param boolean_bins          The bin names hinted as booleans.
+     * @param batch_policy          The as_policy_batch to be used for this
+     *                              operation.
+     * @param error                 as_error reference to be populated by this
+     *                              method in case of error.
+     * @param is_lazy_record        If true, the records are passed as
+     *                              Aerospike\Record objects.
+     *
+     * @return AEROSPIKE_OK if SUCCESS. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status BatchOpManager::execute_batch_get_stream(aerospike *as_p,
+            const Variant& function, int64_t chunk_size,
+            const Variant& php_filter_bins, const Array& boolean_bins,
+            as_policy_batch& batch_policy, as_error& error, bool is_lazy_record)
+    {
+        as_error_reset(&error);
+        batch_stream_udata udata(function, error, boolean_bins);
+        udata.first_key_p = as_batch_keyat(&this->batch, 0);
+        udata.chunk_size = chunk_size;
+        udata.is_lazy_record = is_lazy_record;
+
+        return batch_get(as_p, php_filter_bins, batch_policy,
+                (aerospike_batch_read_callback) &batch_get_stream_cb, &udata, error,
+                &udata.is_stopped);
+    }
+
+    /*
+     *******************************************************************************************
+     * Private member function that runs the batch get of the keys, with the
+     * optional filter bins, invoking the given callback with the results.
+     *
+     * @param as_p                  aerospike pointer for the current batch operation.
+     * @param php_filter_bins       The optional php filter bins array used to
+     *                              select specific bins in the batch get.
+     * @param batch_policy          The as_policy_batch to be used for this
+     *                              operation.
+     * @param callback              The callback invoked by the C client.
+     * @param udata                 The userdata passed to the callback.
+     * @param error                 as_error reference to be populated by this
+     *                              method in case of error.
+     * @param is_stopped_p          If not NULL, set by the callback to stop
+     *                              the batch.
+     *
+     * @return AEROSPIKE_OK if SUCCESS. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status BatchOpManager::batch_get(aerospike *as_p, const Variant& php_filter_bins,
+            as_policy_batch& batch_policy, aerospike_batch_read_callback callback,
+            void *udata, as_error& error, const bool *is_stopped_p)
+    {
         if (!php_filter_bins.isNull() && !php_filter_bins.isArray()) {
             return as_error_update(&error, AEROSPIKE_ERR_PARAM,
                     "Invalid filter bins type: Expected an array or NULL");
         }
 
         if (php_filter_bins.isArray()) {
-            uint16_t            total_filter_count = php_filter_bins.toArray().size();
-            const char          *filter[total_filter_count];
-                    
+            uint32_t                    total_filter_count = php_filter_bins.toArray().size();
+            /*
+             * One more entry for the NULL terminating the filter.
+             */
+            std::vector<const char *>   filter(total_filter_count + 1);
+
             if (AEROSPIKE_OK == process_filter_bins(php_filter_bins.toArray(),
-                        filter, error)) {
-                aerospike_batch_get_bins(as_p, &error, &batch_policy,
-                        &this->batch, filter, total_filter_count,
-                        (aerospike_batch_read_callback) &batch_get_cb,
-                        &udata);
+                        filter.data(), error)) {
+                execute_in_chunks([&](as_batch *batch_p,
+                            aerospike_batch_read_callback chunk_callback, void *udata_p,
+                            as_error& command_error) {
+                        aerospike_batch_get_bins(as_p, &command_error, &batch_policy,
+                                batch_p, filter.data(), total_filter_count, chunk_callback,
+                                udata_p);
+                    }, callback, udata, error, is_stopped_p);
             }
         } else {
-            aerospike_batch_get(as_p, &error, &batch_policy, &this->batch,
-                    (aerospike_batch_read_callback) &batch_get_cb, &udata);
+            execute_in_chunks([&](as_batch *batch_p,
+                        aerospike_batch_read_callback chunk_callback, void *udata_p,
+                        as_error& command_error) {
+                    aerospike_batch_get(as_p, &command_error, &batch_policy, batch_p,
+                            chunk_callback, udata_p);
+                }, callback, udata, error, is_stopped_p);
+        }
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to check whether OPT_POSITIONAL_RESULTS is set within the
+     * options of a batch read
+     *
+     * @param options           The options of the batch read
+     *
+     * @return true if the results are to be aligned with the keys.
+     *******************************************************************************************
+     */
+    bool is_positional_results_requested(const Variant& options)
+    {
+        return options.isArray() && options.toArray().exists(OPT_POSITIONAL_RESULTS) &&
+            options.toArray()[OPT_POSITIONAL_RESULTS].toBoolean();
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to get the OPT_STREAM_CHUNK_SIZE set within the options of a
+     * streamed batch read
+     *
+     * @param options           The options of the batch read
+     * @param chunk_size        Set to the number of records passed per call,
+     *                          0 if the option is not set
+     * @param error             as_error reference to be populated by this function
+     *                          in case of error
+     *
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status get_stream_chunk_size(const Variant& options, int64_t& chunk_size,
+            as_error& error)
+    {
+        as_error_reset(&error);
+
+        chunk_size = 0;
+        if (!options.isArray() || !options.toArray().exists(OPT_STREAM_CHUNK_SIZE)) {
+            return error.code;
+        }
+
+        Variant php_chunk_size = options.toArray()[OPT_STREAM_CHUNK_SIZE];
+        if (!php_chunk_size.isInteger() || php_chunk_size.toInt64() < 0) {
+            return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                    "OPT_STREAM_CHUNK_SIZE must be a non negative integer");
         }
+        chunk_size = php_chunk_size.toInt64();
         return error.code;
     }
 
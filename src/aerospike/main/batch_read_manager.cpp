@@ -0,0 +1,210 @@
+#include "batch_read_manager.h"
+#include "conversions.h"
+#include "ext_aerospike.h"
+#include "helper.h"
+#include "lazy_record.h"
+#include "policy.h"
+
+#include "hphp/runtime/base/packed-array.h"
+
+#include <algorithm>
+
+namespace HPHP {
+
+    /*
+     *******************************************************************************************
+     * This constructor parses the PHP entries array into chunks of C client's
+     * as_batch_read_records. Each entry is an array with the 'key' to be read
+     * and optionally the 'bins' to be read: all of them if NULL or not set,
+     * only the metadata if empty.
+     * The bin names are PHP strings of the entries, which outlive this object,
+     * so their buffers are passed as is.
+     *
+     * @param php_entries   PHP Array reference to the PHP entries array to be
+     *                      used for the batch read.
+     *******************************************************************************************
+     */
+    BatchReadManager::BatchReadManager(const Array& php_entries)
+    {
+        uint32_t size = php_entries.size();
+        uint32_t max_keys = (ini_entry.batch_max_keys > 0) ?
+            (uint32_t) std::min<int64_t>(ini_entry.batch_max_keys, UINT32_MAX) : size;
+        uint32_t entry_iter = 0;
+        std::exception e;
+
+        if (max_keys == 0) {
+            max_keys = 1;
+        }
+        this->chunks.reserve((size + max_keys - 1) / max_keys);
+        this->bin_names.resize(size);
+
+        for (ArrayIter iter(php_entries); iter; ++iter, entry_iter++) {
+            if (entry_iter % max_keys == 0) {
+                this->chunks.emplace_back();
+                as_batch_read_init(&this->chunks.back(),
+                        std::min(max_keys, size - entry_iter));
+            }
+
+            Variant php_entry = iter.second();
+            if (!php_entry.isArray() || !php_entry.toArray().exists(s_key) ||
+                    !php_entry.toArray()[s_key].isArray()) {
+                destroy();
+                throw e;
+            }
+
+            as_batch_read_record *record_p = as_batch_read_reserve(&this->chunks.back());
+            as_error error;
+            as_error_init(&error);
+            if (AEROSPIKE_OK != php_key_to_as_key(php_entry.toArray()[s_key].toArray(),
+                        record_p->key, error)) {
+                destroy();
+                throw e;
+            }
+
+            Variant php_bins = php_entry.toArray().exists(s_bins) ?
+                php_entry.toArray()[s_bins] : init_null();
+            if (php_bins.isNull()) {
+                record_p->read_all_bins = true;
+            } else if (php_bins.isArray()) {
+                std::vector<char *>& entry_bin_names = this->bin_names[entry_iter];
+                for (ArrayIter bin_iter(php_bins.toArray()); bin_iter; ++bin_iter) {
+                    if (!bin_iter.second().isString()) {
+                        destroy();
+                        throw e;
+                    }
+                    entry_bin_names.push_back(
+                            (char *) bin_iter.second().toString().c_str());
+                }
+                record_p->bin_names = entry_bin_names.data();
+                record_p->n_bin_names = entry_bin_names.size();
+            } else {
+                destroy();
+                throw e;
+            }
+        }
+    }
+
+    /*
+     *******************************************************************************************
+     * Private member function that destroys the maintained as_batch_read_records.
+     *******************************************************************************************
+     */
+    void BatchReadManager::destroy()
+    {
+        for (auto& chunk : this->chunks) {
+            as_batch_read_destroy(&chunk);
+        }
+        this->chunks.clear();
+    }
+
+    /*
+     *******************************************************************************************
+     * Public member function that is used to invoke a batch read operation.
+     * The chunks are read concurrently, then their records are converted on
+     * the request thread, in the order of the entries.
+     *
+     * @param as_p                  aerospike pointer for the current batch operation.
+     * @param php_records           The list to be populated with the records,
+     *                              NULL for the records not found.
+     * @param boolean_bins          The bin names hinted as booleans.
+     * @param batch_policy          The as_policy_batch to be used for this
+     *                              operation.
+     * @param error                 as_error reference to be populated by this
+     *                              method in case of error.
+     * @param is_lazy_record        If true, the records are returned as
+     *                              Aerospike\Record objects.
+     *
+     * @return AEROSPIKE_OK if SUCCESS. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status BatchReadManager::execute_batch_read(aerospike *as_p, Array& php_records,
+            const Array& boolean_bins, as_policy_batch& batch_policy,
+            as_error& error, bool is_lazy_record)
+    {
+        std::vector<as_error>   chunk_errors(this->chunks.size());
+        BinNameTable            bin_names;
+
+        as_error_reset(&error);
+        php_records = Array::attach(PackedArray::MakeReserve(this->bin_names.size()));
+
+        run_concurrently(this->chunks.size(), ini_entry.batch_concurrency,
+                [&](uint32_t chunk_iter) {
+            as_error_init(&chunk_errors[chunk_iter]);
+            aerospike_batch_read(as_p, &chunk_errors[chunk_iter], &batch_policy,
+                    &this->chunks[chunk_iter]);
+        });
+
+        for (uint32_t chunk_iter = 0; chunk_iter < this->chunks.size(); chunk_iter++) {
+            as_vector *list_p = &this->chunks[chunk_iter].list;
+            DeserializerBatch deserializer_batch;
+
+            if (AEROSPIKE_OK != chunk_errors[chunk_iter].code) {
+                as_error_copy(&error, &chunk_errors[chunk_iter]);
+                break;
+            }
+
+            /*
+             * Deserialize the user serialized bins of all the records of the
+             * chunk with a single call to a batched deserializer.
+             */
+            if (!is_lazy_record) {
+                for (uint32_t iter = 0; iter < list_p->size; iter++) {
+                    as_batch_read_record *record_p =
+                        (as_batch_read_record *) as_vector_get(list_p, iter);
+                    if (AEROSPIKE_OK == record_p->result) {
+                        deserializer_batch.add_record(&record_p->record);
+                    }
+                }
+                if (AEROSPIKE_OK != deserializer_batch.deserialize(error)) {
+                    break;
+                }
+            }
+
+            for (uint32_t iter = 0; iter < list_p->size; iter++) {
+                as_batch_read_record *record_p =
+                    (as_batch_read_record *) as_vector_get(list_p, iter);
+
+                if (AEROSPIKE_ERR_RECORD_NOT_FOUND == record_p->result) {
+                    php_records.append(init_null());
+                    continue;
+                } else if (AEROSPIKE_OK != record_p->result) {
+                    as_error_update(&error, record_p->result,
+                            "Failed to read a record of the batch");
+                    break;
+                }
+
+                if (is_lazy_record) {
+                    Variant php_record;
+                    as_record_to_lazy_record(&record_p->record, &record_p->key,
+                            php_record, NULL, false, error);
+                    apply_boolean_bins_hint_to_lazy_record(boolean_bins, php_record);
+                    php_records.append(php_record);
+                } else {
+                    Array php_record = Array::Create();
+                    as_record_to_php_record(&record_p->record, &record_p->key,
+                            php_record, NULL, error, &bin_names);
+                    apply_boolean_bins_hint(boolean_bins, php_record);
+                    php_records.append(php_record);
+                }
+                if (AEROSPIKE_OK != error.code) {
+                    break;
+                }
+            }
+            if (AEROSPIKE_OK != error.code) {
+                break;
+            }
+        }
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Destructor for BatchReadManager, destroys the maintained
+     * as_batch_read_records by this object.
+     *******************************************************************************************
+     */
+    BatchReadManager::~BatchReadManager()
+    {
+        destroy();
+    }
+} // namespace HPHP
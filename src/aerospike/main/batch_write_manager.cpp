@@ -0,0 +1,250 @@
+#include "batch_write_manager.h"
+#include "conversions.h"
+#include "helper.h"
+#include "policy.h"
+
+#include "hphp/runtime/base/packed-array.h"
+
+namespace HPHP {
+
+    /*
+     *******************************************************************************************
+     * This constructor parses the PHP keys array into the keys of a
+     * BatchOpManager. Throws if a key is invalid, as BatchOpManager does.
+     *
+     * @param php_keys      PHP Array reference to the PHP keys array to be used
+     *                      for the batch operation.
+     *******************************************************************************************
+     */
+    BatchWriteManager::BatchWriteManager(const Array& php_keys) : batch_keys(php_keys)
+    {
+        as_error_init(&this->first_error);
+        this->first_error_index = UINT32_MAX;
+    }
+
+    /*
+     *******************************************************************************************
+     * Private member function that resets the statuses before running a
+     * batch operation.
+     *******************************************************************************************
+     */
+    void BatchWriteManager::start()
+    {
+        this->statuses.assign(this->batch_keys.size(), AEROSPIKE_OK);
+        as_error_reset(&this->first_error);
+        this->first_error_index = UINT32_MAX;
+    }
+
+    /*
+     *******************************************************************************************
+     * Private member function that sets the status of a key, invoked by the
+     * threads running the batch operation. Every thread sets the statuses of
+     * its own keys, only the error of the first key which failed is shared.
+     *
+     * @param index                 The index of the key within the batch.
+     * @param key_error             The as_error of the command for the key.
+     *******************************************************************************************
+     */
+    void BatchWriteManager::set_status(uint32_t index, const as_error& key_error)
+    {
+        this->statuses[index] = key_error.code;
+        if (AEROSPIKE_OK != key_error.code) {
+            std::lock_guard<std::mutex> guard(this->error_mutex);
+            if (index < this->first_error_index) {
+                as_error_copy(&this->first_error, (as_error *) &key_error);
+                this->first_error_index = index;
+            }
+        }
+    }
+
+    /*
+     *******************************************************************************************
+     * Private member function that populates the statuses of the keys, once
+     * the batch operation is over.
+     *
+     * @param php_statuses          The list to be populated with the status of
+     *                              every key, in the order of the keys.
+     * @param error                 as_error reference to be set to the error of
+     *                              the first key which failed.
+     *
+     * @return AEROSPIKE_OK if every key succeeded. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status BatchWriteManager::get_statuses(Array& php_statuses, as_error& error)
+    {
+        php_statuses = Array::attach(PackedArray::MakeReserve(this->statuses.size()));
+        for (as_status status : this->statuses) {
+            php_statuses.append((int64_t) status);
+        }
+        if (UINT32_MAX != this->first_error_index) {
+            as_error_copy(&error, &this->first_error);
+        }
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Public member function that is used to invoke a batch put operation.
+     *
+     * @param as_p                  aerospike pointer for the current batch operation.
+     * @param php_records           The records to be written, one array of bins
+     *                              per key, in the order of the keys.
+     * @param ttl                   The ttl of the records.
+     * @param gen                   The generation of the records, for the
+     *                              generation policy.
+     * @param write_policy          The as_policy_write to be used for every key.
+     * @param static_pool           StaticPoolManager instance reference, to be used for
+     *                              the conversion lifecycle.
+     * @param serializer_type       The serializer_type to be used to handle
+     *                              the serialization.
+     * @param php_statuses          The list to be populated with the status of
+     *                              every key.
+     * @param error                 as_error reference to be populated by this
+     *                              method in case of error.
+     *
+     * @return AEROSPIKE_OK if SUCCESS. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status BatchWriteManager::execute_put_many(aerospike *as_p, const Array& php_records,
+            int64_t ttl, uint16_t gen, as_policy_write& write_policy,
+            StaticPoolManager& static_pool, int16_t serializer_type,
+            Array& php_statuses, as_error& error)
+    {
+        uint32_t                count = this->batch_keys.size();
+        uint32_t                converted = 0;
+        std::vector<as_record>  records(count);
+
+        as_error_reset(&error);
+
+        if ((uint32_t) php_records.size() != count) {
+            return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                    "The number of records must match the number of keys");
+        }
+
+        for (ArrayIter iter(php_records); iter; ++iter) {
+            if (!iter.second().isArray()) {
+                as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                        "Each record must be an array of bins");
+                break;
+            }
+            php_record_to_as_record(iter.second().toArray(), records[converted],
+                    ttl, static_pool, serializer_type, error);
+            records[converted++].gen = gen;
+            if (AEROSPIKE_OK != error.code) {
+                break;
+            }
+        }
+
+        if (AEROSPIKE_OK == error.code) {
+            start();
+            run_concurrently(count, ini_entry.batch_concurrency, [&](uint32_t index) {
+                as_error key_error;
+                as_error_init(&key_error);
+                aerospike_key_put(as_p, &key_error, &write_policy,
+                        this->batch_keys.key_at(index), &records[index]);
+                set_status(index, key_error);
+            });
+            get_statuses(php_statuses, error);
+        }
+
+        for (uint32_t iter = 0; iter < converted; iter++) {
+            as_record_destroy(&records[iter]);
+        }
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Public member function that is used to invoke a batch remove operation.
+     *
+     * @param as_p                  aerospike pointer for the current batch operation.
+     * @param remove_policy         The as_policy_remove to be used for every key.
+     * @param php_statuses          The list to be populated with the status of
+     *                              every key.
+     * @param error                 as_error reference to be populated by this
+     *                              method in case of error.
+     *
+     * @return AEROSPIKE_OK if SUCCESS. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status BatchWriteManager::execute_remove_many(aerospike *as_p,
+            as_policy_remove& remove_policy, Array& php_statuses, as_error& error)
+    {
+        as_error_reset(&error);
+
+        start();
+        run_concurrently(this->batch_keys.size(), ini_entry.batch_concurrency,
+                [&](uint32_t index) {
+            as_error key_error;
+            as_error_init(&key_error);
+            aerospike_key_remove(as_p, &key_error, &remove_policy,
+                    this->batch_keys.key_at(index));
+            set_status(index, key_error);
+        });
+        return get_statuses(php_statuses, error);
+    }
+
+    /*
+     *******************************************************************************************
+     * Public member function that is used to invoke a batch operate operation,
+     * applying the same operations to every key.
+     *
+     * @param as_p                  aerospike pointer for the current batch operation.
+     * @param operations            The as_operations to be applied to every key.
+     *                              It is only read by the threads.
+     * @param operate_policy        The as_policy_operate to be used for every key.
+     * @param php_statuses          The list to be populated with the status of
+     *                              every key.
+     * @param php_returned          The list to be populated with the bins read
+     *                              by the operations for every key, NULL for the
+     *                              keys which failed.
+     * @param error                 as_error reference to be populated by this
+     *                              method in case of error.
+     *
+     * @return AEROSPIKE_OK if SUCCESS. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status BatchWriteManager::execute_operate_many(aerospike *as_p,
+            as_operations& operations, as_policy_operate& operate_policy,
+            Array& php_statuses, Array& php_returned, as_error& error)
+    {
+        uint32_t                    count = this->batch_keys.size();
+        std::vector<as_record *>    records(count, NULL);
+        as_error                    conversion_error;
+
+        as_error_reset(&error);
+        as_error_init(&conversion_error);
+
+        start();
+        run_concurrently(count, ini_entry.batch_concurrency, [&](uint32_t index) {
+            as_error key_error;
+            as_error_init(&key_error);
+            aerospike_key_operate(as_p, &key_error, &operate_policy,
+                    this->batch_keys.key_at(index), &operations, &records[index]);
+            set_status(index, key_error);
+        });
+        get_statuses(php_statuses, error);
+
+        /*
+         * The returned bins are converted back on the request thread.
+         */
+        php_returned = Array::attach(PackedArray::MakeReserve(count));
+        for (uint32_t iter = 0; iter < count; iter++) {
+            if (!records[iter]) {
+                php_returned.append(init_null());
+                continue;
+            }
+            Array php_bins = Array::Create();
+            if (AEROSPIKE_OK == conversion_error.code) {
+                bins_to_php_bins(records[iter], php_bins, conversion_error);
+            }
+            php_returned.append(php_bins);
+            as_record_destroy(records[iter]);
+        }
+
+        if (AEROSPIKE_OK == error.code && AEROSPIKE_OK != conversion_error.code) {
+            as_error_copy(&error, &conversion_error);
+        }
+        return error.code;
+    }
+} // namespace HPHP
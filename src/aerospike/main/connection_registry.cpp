@@ -0,0 +1,147 @@
+#include "connection_registry.h"
+
+namespace HPHP {
+
+    /*
+     * Aerospike extension globals
+     */
+    ConnectionRegistry persistent_list;
+
+    /*
+     *******************************************************************************************
+     * Constructor for ConnectionRegistry
+     * Publishes an empty snapshot in every shard so that readers never see NULL.
+     *******************************************************************************************
+     */
+    ConnectionRegistry::ConnectionRegistry()
+    {
+        for (uint32_t iter = 0; iter < CONNECTION_REGISTRY_SHARDS; iter++) {
+            shards[iter].snapshot.store(new cluster_map(), std::memory_order_release);
+        }
+    }
+
+    /*
+     *******************************************************************************************
+     * Destructor for ConnectionRegistry
+     * Frees the snapshots. The aerospike_ref entries are released by clear().
+     *******************************************************************************************
+     */
+    ConnectionRegistry::~ConnectionRegistry()
+    {
+        for (uint32_t iter = 0; iter < CONNECTION_REGISTRY_SHARDS; iter++) {
+            for (auto retired_p : shards[iter].retired) {
+                delete retired_p;
+            }
+            shards[iter].retired.clear();
+            delete shards[iter].snapshot.exchange(NULL, std::memory_order_acq_rel);
+        }
+    }
+
+    /*
+     *******************************************************************************************
+     * Private methods to select the shard for a cluster id
+     *******************************************************************************************
+     */
+    ConnectionRegistry::shard& ConnectionRegistry::shard_for(uint64_t cluster_id)
+    {
+        return shards[cluster_id % CONNECTION_REGISTRY_SHARDS];
+    }
+
+    const ConnectionRegistry::shard& ConnectionRegistry::shard_for(uint64_t cluster_id) const
+    {
+        return shards[cluster_id % CONNECTION_REGISTRY_SHARDS];
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to lookup the aerospike_ref published for a cluster id.
+     * Takes no lock; reads the current snapshot of the cluster id's shard.
+     *
+     * @param cluster_id    The cluster id to be looked up.
+     *
+     * @return a pointer to aerospike_ref if found. Otherwise NULL.
+     *******************************************************************************************
+     */
+    aerospike_ref* ConnectionRegistry::find(uint64_t cluster_id) const
+    {
+        const cluster_map *map_p = shard_for(cluster_id).snapshot.load(std::memory_order_acquire);
+
+        if (!map_p) {
+            return NULL;
+        }
+
+        auto it = map_p->find(cluster_id);
+        if (it == map_p->end()) {
+            return NULL;
+        }
+        return it->second;
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to publish an aerospike_ref for a cluster id, unless some other thread
+     * has already published one for it.
+     *
+     * @param cluster_id    The cluster id to be published.
+     * @param ref_p         The aerospike_ref to be published for the cluster id.
+     * @param inserted      Set to true if ref_p got published by this call.
+     *
+     * @return the aerospike_ref published for the cluster id, which is ref_p if
+     * inserted is set. Otherwise the entry published earlier.
+     *******************************************************************************************
+     */
+    aerospike_ref* ConnectionRegistry::insert_if_absent(uint64_t cluster_id,
+            aerospike_ref *ref_p, bool& inserted)
+    {
+        shard&  current_shard = shard_for(cluster_id);
+
+        inserted = false;
+        std::lock_guard<std::mutex> guard(current_shard.writer_mutex);
+
+        const cluster_map *old_map_p = current_shard.snapshot.load(std::memory_order_acquire);
+        auto it = old_map_p->find(cluster_id);
+        if (it != old_map_p->end()) {
+            return it->second;
+        }
+
+        cluster_map *new_map_p = new cluster_map(*old_map_p);
+        (*new_map_p)[cluster_id] = ref_p;
+        current_shard.snapshot.store(new_map_p, std::memory_order_release);
+        current_shard.retired.push_back(old_map_p);
+        inserted = true;
+
+        return ref_p;
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to release all the published entries and snapshots.
+     * Must only be called once no request thread can use the registry
+     * anymore, i.e. on module shutdown.
+     *
+     * @param release       The callback invoked once for every published
+     *                      cluster id with its aerospike_ref.
+     *******************************************************************************************
+     */
+    void ConnectionRegistry::clear(release_callback release)
+    {
+        for (uint32_t iter = 0; iter < CONNECTION_REGISTRY_SHARDS; iter++) {
+            std::lock_guard<std::mutex> guard(shards[iter].writer_mutex);
+            const cluster_map *map_p = shards[iter].snapshot.exchange(new cluster_map(),
+                    std::memory_order_acq_rel);
+
+            if (map_p) {
+                for (auto& entry : *map_p) {
+                    if (entry.second) {
+                        release(entry.second);
+                    }
+                }
+                delete map_p;
+            }
+            for (auto retired_p : shards[iter].retired) {
+                delete retired_p;
+            }
+            shards[iter].retired.clear();
+        }
+    }
+} // namespace HPHP
@@ -1,6 +1,14 @@
 #include "conversions.h"
 #include "ext_aerospike.h"
 #include "constants.h"
+#include "policy.h"
+#include "serializers.h"
+#include "lazy_record.h"
+#include "hphp/runtime/base/mixed-array.h"
+#include "hphp/runtime/base/packed-array.h"
+
+#include <cctype>
+#include <cerrno>
 
 namespace HPHP {
 
@@ -15,48 +23,272 @@ namespace HPHP {
     /*
      * Aerospike extension globals
      */
-     std::unordered_map<std::string, int > shm_key_list;
+     std::unordered_map<uint64_t, int > shm_key_list;
 
     /*
      * Aerospike extension globals
      */
      int shm_key_counter = 0xA5000000;
+
     /*
-    ************************************************************************************
-    * This function will create key in the unordered_map.
-    * Which is host_entry => address:port:user;
-    *
-    * @param alias_to_search    the string with host:port:user;
-    * @param iter_host          the iterator for config. hosts;
-    * @param config             as_config reference to be populated by this function
-    * @param error              as_error reference to be populated by this function
-    *                           in case of error
-    * @return                   alias_to_search created in this function
-    * ************************************************************************************
-    */
+     *******************************************************************************************
+     * Helper function to order the hosts within the config by addr and port,
+     * so that the same cluster given with its hosts in a different order gets
+     * the same identity.
+     *
+     * @param config        as_config holding the hosts to be ordered
+     * @param order         Array of config.hosts_size indices to be populated
+     *                      with the ordered host indices
+     *******************************************************************************************
+     */
+    static void sort_config_hosts(const as_config& config, uint16_t *order)
+    {
+        for (uint16_t iter = 0; iter < config.hosts_size; iter++) {
+            uint16_t    current = iter;
+            int16_t     prev = iter - 1;
+
+            while (prev >= 0) {
+                const as_config_host& host = config.hosts[order[prev]];
+                int cmp = strcmp(host.addr, config.hosts[current].addr);
+                if (cmp < 0 || (cmp == 0 && host.port <= config.hosts[current].port)) {
+                    break;
+                }
+                order[prev + 1] = order[prev];
+                prev--;
+            }
+            order[prev + 1] = current;
+        }
+    }
 
-     char* create_alias(char *alias_to_search,int iter_hosts, as_config& config,
-            as_error& error){
-        char               port[MAX_PORT_SIZE];
-        int                 alias_length;
-        alias_length = strlen(config.hosts[iter_hosts].addr) +
-            MAX_PORT_SIZE + strlen(config.user)+ 3;
-        alias_to_search = (char*) malloc(alias_length);
-        memset(alias_to_search,'\0', alias_length);
-        if(alias_to_search == NULL){
-            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
-                "Memory allocation failed for create alias");
-            return NULL;
+    /*
+     *******************************************************************************************
+     * Helper function to walk the canonical cluster alias of the config,
+     * i.e. "addr:port;" for each of the ordered hosts followed by the user,
+     * handing it to the visitor in pieces so that nothing gets allocated.
+     * The visitor returns false to stop the walk.
+     *
+     * @param config        as_config holding the hosts and user
+     * @param visitor       Callable invoked as visitor(const char *, size_t)
+     *
+     * @return true if the whole alias was visited. Otherwise false.
+     *******************************************************************************************
+     */
+    template <typename Visitor>
+    static bool walk_cluster_alias(const as_config& config, Visitor& visitor)
+    {
+        uint16_t    order[AS_CONFIG_HOSTS_SIZE];
+        char        port[MAX_PORT_SIZE + 1];
+        int         port_length;
+
+        sort_config_hosts(config, order);
+        for (uint16_t iter = 0; iter < config.hosts_size; iter++) {
+            const as_config_host& host = config.hosts[order[iter]];
+
+            port_length = snprintf(port, sizeof(port), ":%d", host.port);
+            if (!visitor(host.addr, strlen(host.addr)) ||
+                    !visitor(port, port_length) ||
+                    !visitor(";", 1)) {
+                return false;
+            }
+        }
+        return visitor(config.user, strlen(config.user));
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to get the identity of the cluster described by the config.
+     * It is the FNV-1a hash of the canonical cluster alias, and is computed
+     * without any heap allocation.
+     *
+     * @param config        as_config holding the hosts and user
+     *
+     * @return the cluster id.
+     *******************************************************************************************
+     */
+    uint64_t get_cluster_id(const as_config& config)
+    {
+        uint64_t    cluster_id = 14695981039346656037ULL;
+        auto        hash_visitor = [&cluster_id](const char *bytes, size_t length) {
+            for (size_t iter = 0; iter < length; iter++) {
+                cluster_id ^= (uint8_t) bytes[iter];
+                cluster_id *= 1099511628211ULL;
+            }
+            return true;
+        };
+
+        walk_cluster_alias(config, hash_visitor);
+        return cluster_id;
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to create the canonical cluster alias of the config.
+     * Only needed when a new persistent connection is created, to resolve
+     * cluster id collisions later on through is_same_cluster().
+     *
+     * @param config        as_config holding the hosts and user
+     * @param cluster_alias The string to be populated with the alias
+     *******************************************************************************************
+     */
+    void create_cluster_alias(const as_config& config, std::string& cluster_alias)
+    {
+        auto        append_visitor = [&cluster_alias](const char *bytes, size_t length) {
+            cluster_alias.append(bytes, length);
+            return true;
+        };
+
+        cluster_alias.clear();
+        walk_cluster_alias(config, append_visitor);
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to check whether the config describes the cluster with the
+     * given canonical cluster alias, without any heap allocation.
+     *
+     * @param config        as_config holding the hosts and user
+     * @param cluster_alias The alias created by create_cluster_alias()
+     *
+     * @return true if the config matches the alias. Otherwise false.
+     *******************************************************************************************
+     */
+    bool is_same_cluster(const as_config& config, const std::string& cluster_alias)
+    {
+        size_t      offset = 0;
+        auto        compare_visitor = [&cluster_alias, &offset](const char *bytes, size_t length) {
+            if (cluster_alias.compare(offset, length, bytes, length) != 0) {
+                return false;
+            }
+            offset += length;
+            return true;
+        };
+
+        return walk_cluster_alias(config, compare_visitor) &&
+            offset == cluster_alias.size();
+    }
+
+    /*
+     *******************************************************************************************
+     * Constructor for chunked pool
+     *
+     * @param element_size  The size of each element of the pool
+     *******************************************************************************************
+     */
+    ChunkedPool::ChunkedPool(size_t element_size) : element_size(element_size) { }
+
+    /*
+     *******************************************************************************************
+     * Method to get an element from the chunked pool, adding a chunk if the
+     * existing ones are all used.
+     *
+     * @return a pointer to an uninitialized element if success. Otherwise NULL.
+     *******************************************************************************************
+     */
+    void* ChunkedPool::get()
+    {
+        uint32_t    capacity;
+        void        *elements = NULL;
+
+        while (chunk_index < chunks.size() &&
+                element_index >= chunks[chunk_index].capacity) {
+            chunk_index++;
+            element_index = 0;
         }
-        strcpy(alias_to_search, config.hosts[iter_hosts].addr);
-        strcat(alias_to_search,(char *) ":");
-        sprintf(port , "%d", config.hosts[iter_hosts].port);
-        strcat(alias_to_search, port);
-        strcat(alias_to_search,(char *) ":");
-        strcat(alias_to_search, config.user);
-        strcat(alias_to_search,(char *) ";");
-        return alias_to_search;
-     }
+
+        if (chunk_index == chunks.size()) {
+            capacity = chunks.empty() ? FIRST_CHUNK_SIZE : chunks.back().capacity * 2;
+            if (capacity > MAX_CHUNK_SIZE) {
+                capacity = MAX_CHUNK_SIZE;
+            }
+            if (NULL == (elements = calloc(capacity, element_size))) {
+                return NULL;
+            }
+            chunks.push_back({elements, capacity});
+            element_index = 0;
+        }
+
+        return (char *) chunks[chunk_index].elements + (element_size * element_index++);
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to rewind the chunked pool, keeping its chunks for reuse.
+     *
+     * @param destroy       Callback invoked on every element handed out since
+     *                      the last reset, NULL to skip.
+     *******************************************************************************************
+     */
+    void ChunkedPool::reset(destroy_callback destroy)
+    {
+        uint32_t    used;
+
+        if (destroy) {
+            for (uint32_t iter = 0; iter <= chunk_index && iter < chunks.size(); iter++) {
+                used = (iter < chunk_index) ? chunks[iter].capacity : element_index;
+                for (uint32_t element = 0; element < used; element++) {
+                    destroy((char *) chunks[iter].elements + (element_size * element));
+                }
+            }
+        }
+        chunk_index = 0;
+        element_index = 0;
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to visit every element ever handed out by the chunked pool, e.g.
+     * to free the state kept by the elements across resets.
+     * Elements never handed out are zeroed.
+     *
+     * @param release_element   Callback invoked on every element of every chunk
+     *******************************************************************************************
+     */
+    void ChunkedPool::release(destroy_callback release_element)
+    {
+        for (auto& current_chunk : chunks) {
+            for (uint32_t element = 0; element < current_chunk.capacity; element++) {
+                release_element((char *) current_chunk.elements + (element_size * element));
+            }
+        }
+    }
+
+    /*
+     *******************************************************************************************
+     * Destructor for chunked pool
+     * Frees up all the chunks in bulk
+     *******************************************************************************************
+     */
+    ChunkedPool::~ChunkedPool()
+    {
+        for (auto& current_chunk : chunks) {
+            free(current_chunk.elements);
+        }
+    }
+
+    /*
+     *******************************************************************************************
+     * Callbacks to destroy the elements of the chunked pools
+     *******************************************************************************************
+     */
+    static void destroy_pooled_as_string(void *element_p)
+    {
+        as_string_destroy((as_string *) element_p);
+    }
+
+    static void destroy_pooled_as_integer(void *element_p)
+    {
+        as_integer_destroy((as_integer *) element_p);
+    }
+
+    static void destroy_pooled_as_double(void *element_p)
+    {
+        as_double_destroy((as_double *) element_p);
+    }
+
+    static void destroy_pooled_as_hashmap(void *element_p)
+    {
+        as_hashmap_destroy((as_hashmap *) element_p);
+    }
 
     /*
      *******************************************************************************************
@@ -74,10 +306,7 @@ namespace HPHP {
      */
     as_string* StaticPoolManager::get_as_string()
     {
-        if (string_pool_index >= STATIC_POOL_MAX_SIZE) {
-            return NULL;
-        }
-        return &string_pool[string_pool_index++];
+        return (as_string *) string_pool.get();
     }
 
     /*
@@ -89,25 +318,82 @@ namespace HPHP {
      */
     as_integer* StaticPoolManager::get_as_integer()
     {
-        if (integer_pool_index >= STATIC_POOL_MAX_SIZE) {
-            return NULL;
-        }
-        return &integer_pool[integer_pool_index++];
+        return (as_integer *) integer_pool.get();
     }
 
     /*
      *******************************************************************************************
-     * Method to get an as_arraylist from current static pool
+     * Method to get an as_double from current static pool
+     *
+     * @return a pointer to as_double if success. Otherwise NULL.
+     *******************************************************************************************
+     */
+    as_double* StaticPoolManager::get_as_double()
+    {
+        return (as_double *) double_pool.get();
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to get an initialized as_arraylist from current static pool.
+     * The list's element storage is recycled from earlier uses of the pooled
+     * list, and only grown when it is too small.
+     *
+     * @param capacity      The capacity of the list
      *
      * @return a pointer to as_arraylist if success. Otherwise NULL.
      *******************************************************************************************
      */
-    as_arraylist* StaticPoolManager::get_as_arraylist()
+    as_arraylist* StaticPoolManager::get_as_arraylist(uint32_t capacity)
     {
-        if (list_pool_index >= STATIC_POOL_MAX_SIZE) {
+        pooled_arraylist    *pooled_p = (pooled_arraylist *) list_pool.get();
+        as_val              **storage = NULL;
+
+        if (!pooled_p) {
             return NULL;
         }
-        return &list_pool[list_pool_index++];
+
+        if (pooled_p->storage_capacity < capacity) {
+            if (NULL == (storage = (as_val **) malloc(sizeof(as_val *) * capacity))) {
+                return NULL;
+            }
+            free(pooled_p->storage);
+            pooled_p->storage = storage;
+            pooled_p->storage_capacity = capacity;
+        }
+
+        /*
+         * Same as as_arraylist_init(), except that the element storage is not
+         * owned by the list.
+         */
+        as_list_cons((as_list *) &pooled_p->list, false, NULL, &as_arraylist_list_hooks);
+        pooled_p->list.block_size = 0;
+        pooled_p->list.capacity = capacity;
+        pooled_p->list.size = 0;
+        pooled_p->list.elements = pooled_p->storage;
+        pooled_p->list.free = false;
+
+        return &pooled_p->list;
+    }
+
+    /*
+     *******************************************************************************************
+     * Callbacks to destroy a pooled as_arraylist, keeping its element storage,
+     * and to free the element storage once the pool goes away.
+     *******************************************************************************************
+     */
+    void StaticPoolManager::destroy_pooled_arraylist(void *element_p)
+    {
+        as_arraylist_destroy(&((pooled_arraylist *) element_p)->list);
+    }
+
+    void StaticPoolManager::release_pooled_arraylist(void *element_p)
+    {
+        pooled_arraylist    *pooled_p = (pooled_arraylist *) element_p;
+
+        free(pooled_p->storage);
+        pooled_p->storage = NULL;
+        pooled_p->storage_capacity = 0;
     }
 
     /*
@@ -119,10 +405,7 @@ namespace HPHP {
      */
     as_hashmap* StaticPoolManager::get_as_hashmap()
     {
-        if (map_pool_index >= STATIC_POOL_MAX_SIZE) {
-            return NULL;
-        }
-        return &map_pool[map_pool_index++];
+        return (as_hashmap *) map_pool.get();
     }
 
     /*
@@ -134,10 +417,41 @@ namespace HPHP {
      */
     as_bytes* StaticPoolManager::get_as_bytes()
     {
-        if (bytes_pool_index >= STATIC_POOL_MAX_SIZE) {
-            return NULL;
-        }
-        return &bytes_pool[bytes_pool_index++];
+        return (as_bytes *) bytes_pool.get();
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to pin a PHP string in the static pool, i.e. to hold a reference
+     * to its StringData until the pool is reset. The buffer of the returned
+     * string can then be wrapped by non-owning as_string/as_bytes.
+     *
+     * @param php_string    The PHP string to be pinned.
+     *
+     * @return the pinned PHP string.
+     *******************************************************************************************
+     */
+    const String& StaticPoolManager::pin_string(const String& php_string)
+    {
+        pinned_strings.push_back(php_string);
+        return pinned_strings.back();
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to destroy all the used as_* of the static pool and rewind it,
+     * keeping the pool's memory for reuse.
+     *******************************************************************************************
+     */
+    void StaticPoolManager::reset()
+    {
+        string_pool.reset(destroy_pooled_as_string);
+        integer_pool.reset(destroy_pooled_as_integer);
+        double_pool.reset(destroy_pooled_as_double);
+        list_pool.reset(destroy_pooled_arraylist);
+        map_pool.reset(destroy_pooled_as_hashmap);
+        bytes_pool.reset(NULL);
+        pinned_strings.clear();
     }
 
     /*
@@ -148,18 +462,46 @@ namespace HPHP {
      */
     StaticPoolManager::~StaticPoolManager()
     {
-        uint16_t iter = 0;
-        for (iter = 0; iter < string_pool_index; iter++) {
-            as_string_destroy(&string_pool[iter]);
-        }
-        for (iter = 0; iter < integer_pool_index; iter++) {
-            as_integer_destroy(&integer_pool[iter]);
-        }
-        for (iter = 0; iter < list_pool_index; iter++) {
-            as_arraylist_destroy(&list_pool[iter]);
+        reset();
+        list_pool.release(release_pooled_arraylist);
+    }
+
+    /*
+     * Aerospike extension globals
+     */
+    thread_local StaticPoolManager StaticPoolScope::thread_pool;
+    thread_local bool StaticPoolScope::is_thread_pool_in_use = false;
+
+    /*
+     *******************************************************************************************
+     * Constructor for static pool scope
+     * Borrows the thread's pool, unless it is already borrowed.
+     *******************************************************************************************
+     */
+    StaticPoolScope::StaticPoolScope()
+    {
+        if (is_thread_pool_in_use) {
+            pool_p = new StaticPoolManager();
+        } else {
+            is_thread_pool_in_use = true;
+            pool_p = &thread_pool;
         }
-        for (iter = 0; iter < map_pool_index; iter++) {
-            as_hashmap_destroy(&map_pool[iter]);
+    }
+
+    /*
+     *******************************************************************************************
+     * Destructor for static pool scope
+     * Resets the thread's pool for the next scope, or destroys the pool of
+     * its own.
+     *******************************************************************************************
+     */
+    StaticPoolScope::~StaticPoolScope()
+    {
+        if (pool_p == &thread_pool) {
+            thread_pool.reset();
+            is_thread_pool_in_use = false;
+        } else {
+            delete pool_p;
         }
     }
 
@@ -167,16 +509,24 @@ namespace HPHP {
      *******************************************************************************************************
      * Sets value of as_bytes with bytes from bytes_string.
      * Sets type of as_bytes to bytes_type.
+     * If aerospike.zero_copy_writes is enabled, the string is pinned in the
+     * static pool and wrapped by the as_bytes, instead of being copied.
+     * If the string is a value serialized by the PHP or binary serializer of
+     * at least aerospike.compression_threshold bytes, it is compressed, and
+     * flagged as such in its header, keeping the AS_BYTES_PHP type. The blobs of
+     * the JSON and user serializers are left as they are, since other
+     * consumers of the blobs rely on their contents.
      *
      * @param bytes_p               The C client's as_bytes to be set.
      * @param serialized_string     The bytes string to be set into as_bytes.
      * @param bytes_type            The type of as_bytes to be set.
+     * @param static_pool           The static pool to pin the string in.
      * @param error                 The as_error to be populated by the function
      *                              with encountered error if any.
      *******************************************************************************************************
      */
     as_status set_as_bytes(as_bytes **bytes_p, HPHP::String serialized_string, int32_t bytes_type,
-            as_error& error)
+            StaticPoolManager& static_pool, as_error& error)
     {
         as_error_reset(&error);
 
@@ -184,6 +534,23 @@ namespace HPHP {
             return as_error_update(&error, AEROSPIKE_ERR_PARAM,
                     "Unable to set as_bytes");
         }
+        if (AS_BYTES_PHP == bytes_type &&
+                ini_entry.compression_threshold > 0 &&
+                serialized_string.size() >= ini_entry.compression_threshold) {
+            String compressed_string;
+
+            if (compress_serialized(serialized_string, compressed_string)) {
+                serialized_string = compressed_string;
+            }
+        }
+        if (ini_entry.zero_copy_writes) {
+            const String& pinned_string = static_pool.pin_string(serialized_string);
+
+            as_bytes_init_wrap(*bytes_p, (uint8_t *) pinned_string.data(),
+                    pinned_string.size(), false);
+            as_bytes_set_type(*bytes_p, (as_bytes_type) bytes_type);
+            return error.code;
+        }
         if (!as_bytes_init(*bytes_p, serialized_string.size())) {
             return as_error_update(&error, AEROSPIKE_ERR_PARAM,
                     "Unable to initialize as_bytes");
@@ -220,16 +587,13 @@ namespace HPHP {
             as_error& error)
     {
         Array params = Array::Create();
-        char *bytes_val_p = (char *) (*bytes)->value;
-        Variant callback_arg;
 
         as_error_reset(&error);
 
         if (serialize_flag) {
             params.append(value);
         } else {
-            callback_arg = String(bytes_val_p);
-            params.append(callback_arg);
+            params.append(String((const char *) (*bytes)->value, (*bytes)->size, CopyString));
         }
 
         Variant ret_value_callback = vm_call_user_func(callback,
@@ -247,6 +611,205 @@ namespace HPHP {
         }
     }
 
+    /*
+     * Aerospike extension globals
+     */
+    thread_local DeserializerBatch *DeserializerBatch::current_p = NULL;
+    thread_local bool CollectionsScope::is_requested = false;
+    thread_local bool DecodeJsonScope::is_requested = false;
+
+    /*
+     *******************************************************************************************
+     * Constructor for collections scope
+     * Sets whether lists and maps are read as collections, until it is
+     * destroyed.
+     *******************************************************************************************
+     */
+    CollectionsScope::CollectionsScope(bool requested) : was_requested(is_requested)
+    {
+        is_requested = requested;
+    }
+
+    /*
+     *******************************************************************************************
+     * Destructor for collections scope
+     * Restores the setting of the enclosing scope.
+     *******************************************************************************************
+     */
+    CollectionsScope::~CollectionsScope()
+    {
+        is_requested = was_requested;
+    }
+
+    /*
+     *******************************************************************************************
+     * Constructor for decode JSON scope
+     * Sets whether blobs are decoded as JSON, until it is destroyed.
+     *******************************************************************************************
+     */
+    DecodeJsonScope::DecodeJsonScope(bool requested) : was_requested(is_requested)
+    {
+        is_requested = requested;
+    }
+
+    /*
+     *******************************************************************************************
+     * Destructor for decode JSON scope
+     * Restores the setting of the enclosing scope.
+     *******************************************************************************************
+     */
+    DecodeJsonScope::~DecodeJsonScope()
+    {
+        is_requested = was_requested;
+    }
+
+    /*
+     *******************************************************************************************
+     * Constructor for deserializer batch
+     * Makes the batch the current one of the thread, until it is destroyed.
+     *******************************************************************************************
+     */
+    DeserializerBatch::DeserializerBatch() : previous_p(current_p)
+    {
+        current_p = this;
+    }
+
+    /*
+     *******************************************************************************************
+     * Destructor for deserializer batch
+     * Restores the enclosing batch as the current one of the thread.
+     *******************************************************************************************
+     */
+    DeserializerBatch::~DeserializerBatch()
+    {
+        current_p = previous_p;
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to check whether the as_bytes is already added to this batch or
+     * to an enclosing one.
+     *******************************************************************************************
+     */
+    bool DeserializerBatch::contains(const as_bytes *bytes_p) const
+    {
+        for (const DeserializerBatch *batch_p = this; batch_p; batch_p = batch_p->previous_p) {
+            if (batch_p->indexes.count(bytes_p)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to add a user serialized as_bytes to the batch. The serialized
+     * value is passed to the deserializer as a binary safe string of the
+     * size of the as_bytes.
+     *
+     * @param bytes_p       The as_bytes to be deserialized with the batch
+     *******************************************************************************************
+     */
+    void DeserializerBatch::add_bytes(const as_bytes *bytes_p)
+    {
+        if (!Aerospike::is_deserializer_registered || !Aerospike::is_deserializer_batched ||
+                DecodeJsonScope::requested() || !bytes_p || !bytes_p->value ||
+                AS_BYTES_BLOB != as_bytes_get_type(bytes_p) || contains(bytes_p)) {
+            return;
+        }
+        indexes.emplace(bytes_p, blobs.size());
+        blobs.append(String((const char *) bytes_p->value, bytes_p->size, CopyString));
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to add the user serialized bins of a record to the batch.
+     * Blobs nested within list and map bins are left to be deserialized one
+     * at a time.
+     *
+     * @param record_p      The as_record whose bins are to be deserialized
+     *                      with the batch
+     *******************************************************************************************
+     */
+    void DeserializerBatch::add_record(const as_record *record_p)
+    {
+        if (!Aerospike::is_deserializer_batched || !record_p) {
+            return;
+        }
+        for (uint16_t iter = 0; iter < record_p->bins.size; iter++) {
+            const as_val *value_p = (const as_val *) record_p->bins.entries[iter].valuep;
+            if (value_p && AS_BYTES == as_val_type(value_p)) {
+                add_bytes((const as_bytes *) value_p);
+            }
+        }
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to deserialize all the added as_bytes with a single call to the
+     * batched deserializer, which is passed the list of serialized strings
+     * and must return an array with the deserialized value at the index of
+     * every one of them.
+     *
+     * @param error         as_error reference to be populated by this method
+     *                      in case of error
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status DeserializerBatch::deserialize(as_error& error)
+    {
+        as_error_reset(&error);
+
+        if (blobs.empty() || values.size() == blobs.size()) {
+            return error.code;
+        }
+
+        Array params = Array::Create();
+        params.append(blobs);
+
+        Variant ret_value_callback = vm_call_user_func(Aerospike::deserializer, params);
+        if (!ret_value_callback.isArray()) {
+            return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                    "Unable to call user's registered batch deserializer callback");
+        }
+
+        values = ret_value_callback.toArray();
+        for (int64_t index = 0; index < blobs.size(); index++) {
+            if (!values.exists(index)) {
+                values = Array::Create();
+                return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                        "Batch deserializer callback must return a value for every serialized value");
+            }
+        }
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Static method to find the deserialized value of an as_bytes within the
+     * current batch of the thread or an enclosing one.
+     *
+     * @param bytes_p       The as_bytes to be found
+     * @param php_value     PHP Variant reference to be populated with the
+     *                      deserialized value
+     * @return true if the value is found.
+     *******************************************************************************************
+     */
+    bool DeserializerBatch::find(const as_bytes *bytes_p, Variant& php_value)
+    {
+        for (const DeserializerBatch *batch_p = current_p; batch_p; batch_p = batch_p->previous_p) {
+            auto it = batch_p->indexes.find(bytes_p);
+            if (it != batch_p->indexes.end()) {
+                if (!batch_p->values.exists(it->second)) {
+                    return false;
+                }
+                php_value = batch_p->values[it->second];
+                return true;
+            }
+        }
+        return false;
+    }
+
     /*
      *******************************************************************************************************
      * Serializes data (value_to_serialize) into as_bytes using serialization logic
@@ -279,11 +842,19 @@ namespace HPHP {
                     return as_error_update(&error, AEROSPIKE_ERR_PARAM,
                             "Unable to serialize using standard PHP serializer");
                 }
-                set_as_bytes(bytes_p, serialized_string, AS_BYTES_PHP, error);
+                set_as_bytes(bytes_p, serialized_string, AS_BYTES_PHP, static_pool, error);
                 break;
             case SERIALIZER_JSON:
-                as_error_update(&error, AEROSPIKE_ERR_PARAM,
-                        "Unable to serialize using standard JSON serializer");
+                *bytes_p = static_pool.get_as_bytes();
+                if (AEROSPIKE_OK == json_serialize(value_to_serialize, serialized_string, error)) {
+                    set_as_bytes(bytes_p, serialized_string, AS_BYTES_BLOB, static_pool, error);
+                }
+                break;
+            case SERIALIZER_BINARY:
+                *bytes_p = static_pool.get_as_bytes();
+                if (AEROSPIKE_OK == binary_serialize(value_to_serialize, serialized_string, error)) {
+                    set_as_bytes(bytes_p, serialized_string, AS_BYTES_HHVM_BINARY, static_pool, error);
+                }
                 break;
             case SERIALIZER_USER:
                 *bytes_p = static_pool.get_as_bytes();
@@ -291,7 +862,8 @@ namespace HPHP {
                     execute_user_callback(Aerospike::serializer, bytes_p, value_to_serialize,
                             true, error);
                     if (error.code == AEROSPIKE_OK) {
-                        set_as_bytes(bytes_p, value_to_serialize.toString(), AS_BYTES_BLOB, error);
+                        set_as_bytes(bytes_p, value_to_serialize.toString(), AS_BYTES_BLOB,
+                                static_pool, error);
                     }
                 } else {
                     as_error_update(&error, AEROSPIKE_ERR_PARAM, "No serializer callback registered");
@@ -329,13 +901,50 @@ namespace HPHP {
         switch (as_bytes_get_type(bytes_p)) {
             case AS_BYTES_PHP:
                 {
+                    /*
+                     * Also the type of the binary serialized and of the
+                     * compressed values, which start with a magic byte
+                     * serialize() never writes.
+                     */
+                    if (is_compressed_serialized(bytes_p->value, bytes_p->size)) {
+                        String      serialized_string;
+                        as_bytes    serialized_bytes;
+
+                        if (AEROSPIKE_OK != decompress_serialized(bytes_p->value, bytes_p->size,
+                                    serialized_string, error)) {
+                            break;
+                        }
+                        as_bytes_init_wrap(&serialized_bytes, (uint8_t *) serialized_string.data(),
+                                serialized_string.size(), false);
+                        as_bytes_set_type(&serialized_bytes, AS_BYTES_PHP);
+                        unserialize_based_on_as_bytes_type(&serialized_bytes, php_value, error);
+                        as_bytes_destroy(&serialized_bytes);
+                        break;
+                    }
+                    if (bytes_p->size > 0 && BINARY_MAGIC == bytes_p->value[0]) {
+                        binary_unserialize(bytes_p->value, bytes_p->size, php_value, error);
+                        break;
+                    }
                     Variant pval = unserialize_ex((char *) bytes_p->value, bytes_p->size,VariableUnserializer::Type::Serialize);
                     php_value = pval;
                 }
                 break;
             case AS_BYTES_BLOB:
                 {
-                    if (Aerospike::is_deserializer_registered) {
+                    if (DecodeJsonScope::requested()) {
+                        json_unserialize(bytes_p->value, bytes_p->size, php_value, error);
+                    } else if (Aerospike::is_deserializer_registered && Aerospike::is_deserializer_batched) {
+                        if (!DeserializerBatch::find(bytes_p, php_value)) {
+                            DeserializerBatch deserializer_batch;
+
+                            deserializer_batch.add_bytes(bytes_p);
+                            if (AEROSPIKE_OK == deserializer_batch.deserialize(error) &&
+                                    !DeserializerBatch::find(bytes_p, php_value)) {
+                                as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                                        "Unable to call user's registered batch deserializer callback");
+                            }
+                        }
+                    } else if (Aerospike::is_deserializer_registered) {
                         execute_user_callback(Aerospike::deserializer, &bytes_p, php_value,
                                 false, error);
                         if (error.code != AEROSPIKE_OK) {
@@ -401,48 +1010,22 @@ namespace HPHP {
      */
     static as_status verify_shm_key_store_it(as_config& config, as_error& error)
     {
+        int                 unique_shm_key = -1;
+        uint64_t            cluster_id = get_cluster_id(config);
 
-        std::string         ini_value;
-        char                *alias_to_search = NULL;
-        int                 unique_shm_key =-1;
-        int                 iter_hosts;
-        char                *alias_host_port=NULL;
-        int                 alias_length=0;
-        for (iter_hosts = 0; iter_hosts < config.hosts_size; iter_hosts++) {
-            alias_length += strlen(config.hosts[iter_hosts].addr) +
-            MAX_PORT_SIZE + 3 + strlen(config.user);
-        }
-        alias_to_search = (char*) malloc(alias_length);
-        if(alias_to_search == NULL){
-            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
-                "Memory allocation failed for create alias");
-            return error.code;
-        }
-        memset(alias_to_search,'\0', alias_length);
-        for (iter_hosts = 0; iter_hosts < config.hosts_size; iter_hosts++) {
-            if(NULL == ( alias_host_port= create_alias(alias_host_port,iter_hosts, config,error)) || (error.code != AEROSPIKE_OK)){
-                return error.code;
-            }
-            strcat(alias_to_search , alias_host_port);
-        }
-        std::unordered_map<std::string,int>::const_iterator iter = shm_key_list.find (alias_to_search);
-        if(iter != shm_key_list.end()){
+        std::unordered_map<uint64_t, int>::const_iterator iter = shm_key_list.find(cluster_id);
+        if (iter != shm_key_list.end()) {
             unique_shm_key = iter->second;
         }
-        if(unique_shm_key == -1){
-           if(is_unique_shm_key(config.shm_key)){
+        if (unique_shm_key == -1) {
+            if (is_unique_shm_key(config.shm_key)) {
                 unique_shm_key = config.shm_key;
-            }
-            else{
+            } else {
                 unique_shm_key = generate_unique_shm_key();
             }
-            shm_key_list[alias_to_search] = unique_shm_key;
+            shm_key_list[cluster_id] = unique_shm_key;
             config.shm_key = unique_shm_key;
         }
-        if (alias_to_search) {
-            free(alias_to_search);
-            alias_to_search = NULL;
-        }
         return error.code;
     }
 
@@ -514,6 +1097,25 @@ namespace HPHP {
         }
     }
 
+    /*
+     *******************************************************************************************
+     * Helper function to configure the Lua UDF paths within the supplied
+     * as_config from the php.ini.
+     *******************************************************************************************
+     */
+    static void configure_lua_paths(as_config& config)
+    {
+        std::string ini_value;
+
+        if (IniSetting::Get("aerospike.udf.lua_system_path", ini_value)) {
+            strcpy(config.lua.system_path, ini_value.c_str());
+        }
+
+        if (IniSetting::Get("aerospike.udf.lua_user_path", ini_value)) {
+            strcpy(config.lua.user_path, ini_value.c_str());
+        }
+    }
+
     /*
      *******************************************************************************************
      * Function to free shm key list
@@ -578,37 +1180,165 @@ namespace HPHP {
             }
         }
 
-        if (IniSetting::Get("aerospike.udf.lua_system_path", ini_value)) {
-            strcpy(config.lua.system_path, ini_value.c_str());
+        configure_lua_paths(config);
+
+        for (uint16_t i = 0; i < hosts_array.length(); i++) {
+            if (!hosts_array[i].isArray()) {
+                return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                        "Invalid hosts array: Value of each host is expected to be an array of addr, port");
+            }
+
+            Array host = hosts_array[i].toArray();
+            if (!host.exists(s_addr) ||
+                    !host[s_addr].isString() ||
+                    !host.exists(s_port) ||
+                    (!host[s_port].isInteger() && !host[s_port].isString())) {
+                return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                        "Invalid hosts array: Value of each host is expected to be an array of addr, port");
+            }
+
+            config.hosts[i].addr = host[s_addr].toString().c_str();
+            config.hosts[i].port = host[s_port].isInteger() ? host[s_port].toInt64() : host[s_port].isString() ? atoi(host[s_port].toString().c_str()) : 0;
+            config.hosts_size++;
+        }
+        if(AEROSPIKE_OK != verify_shm_key_store_it(config,error)) {
+            return error.code;
         }
+        return error.code;
+    }
 
-        if (IniSetting::Get("aerospike.udf.lua_user_path", ini_value)) {
-            strcpy(config.lua.user_path, ini_value.c_str());
+    /*
+     *******************************************************************************************
+     * Function to parse a host declared within the php.ini, given as addr,
+     * addr:port, or [addr]:port for IPv6 addresses. An IPv6 address without
+     * brackets is taken as a whole, with the default port.
+     * The addr within the host points into host_p, so it must outlive the
+     * host.
+     *
+     * @param host_p        The host string, modified in place
+     * @param host          as_config_host reference to be populated by this function
+     * @param error         as_error reference to be populated by this function
+     *                      in case of error
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    static as_status ini_host_to_as_config_host(char *host_p, as_config_host& host, as_error& error)
+    {
+        char        *port_p = NULL;
+        char        *end_p = NULL;
+        long        port = DEFAULT_PORT;
+
+        if ('[' == host_p[0]) {
+            end_p = strchr(host_p, ']');
+            if (!end_p || (end_p[1] != '\0' && end_p[1] != ':')) {
+                return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                        "Invalid cluster: Invalid host");
+            }
+            *end_p = '\0';
+            port_p = ':' == end_p[1] ? end_p + 2 : NULL;
+            host_p++;
+        } else {
+            port_p = strchr(host_p, ':');
+            if (port_p && strchr(port_p + 1, ':')) {
+                port_p = NULL;
+            } else if (port_p) {
+                *port_p++ = '\0';
+            }
         }
 
-        for (uint16_t i = 0; i < hosts_array.length(); i++) {
-            if (!hosts_array[i].isArray()) {
+        if (port_p) {
+            errno = 0;
+            port = strtol(port_p, &end_p, 10);
+            if (errno || end_p == port_p || *end_p != '\0' || port <= 0 || port > UINT16_MAX) {
+                return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                        "Invalid cluster: Invalid port");
+            }
+        }
+        if ('\0' == host_p[0]) {
+            return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                    "Invalid cluster: Empty host address");
+        }
+
+        host.addr = host_p;
+        host.port = (uint16_t) port;
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to convert a cluster declared within the php.ini into as_config.
+     * The cluster is an optional user:password@ followed by a ',' separated
+     * list of hosts, each given as addr[:port] or [addr]:port.
+     * The hosts within the as_config point into cluster_p, so it must outlive
+     * the as_config.
+     *
+     * @param cluster_p     The cluster string, tokenized in place
+     * @param config        as_config reference to be populated by this function
+     * @param error         as_error reference to be populated by this function
+     *                      in case of error
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status ini_cluster_to_as_config(char *cluster_p, as_config& config, as_error& error)
+    {
+        char        *hosts_p = cluster_p;
+        char        *credentials_p = NULL;
+        char        *password_p = NULL;
+        char        *host_p = NULL;
+        char        *save_p = NULL;
+
+        as_error_reset(&error);
+
+        as_config_init(&config);
+        check_and_configure_shm(Array::Create(), config, error);
+        if (error.code != AEROSPIKE_OK) {
+            return error.code;
+        }
+        configure_lua_paths(config);
+
+        /*
+         * The password may hold an '@', while the hosts never do, so the
+         * credentials end at the last one.
+         */
+        hosts_p = strrchr(cluster_p, '@');
+        if (hosts_p) {
+            *hosts_p++ = '\0';
+            credentials_p = cluster_p;
+            while (isspace(*credentials_p)) {
+                credentials_p++;
+            }
+            password_p = strchr(credentials_p, ':');
+            if (!password_p || password_p == credentials_p) {
                 return as_error_update(&error, AEROSPIKE_ERR_PARAM,
-                        "Invalid hosts array: Value of each host is expected to be an array of addr, port");
+                        "Invalid cluster: Credentials expected as user:password@");
             }
-
-            Array host = hosts_array[i].toArray();
-            if (!host.exists(s_addr) ||
-                    !host[s_addr].isString() ||
-                    !host.exists(s_port) ||
-                    (!host[s_port].isInteger() && !host[s_port].isString())) {
+            *password_p++ = '\0';
+            if (!as_config_set_user(&config, credentials_p, password_p)) {
                 return as_error_update(&error, AEROSPIKE_ERR_PARAM,
-                        "Invalid hosts array: Value of each host is expected to be an array of addr, port");
+                        "Unable to set username and password");
             }
+        } else {
+            hosts_p = cluster_p;
+        }
 
-            config.hosts[i].addr = host[s_addr].toString().c_str();
-            config.hosts[i].port = host[s_port].isInteger() ? host[s_port].toInt64() : host[s_port].isString() ? atoi(host[s_port].toString().c_str()) : 0;
+        for (host_p = strtok_r(hosts_p, ", \t", &save_p); host_p;
+                host_p = strtok_r(NULL, ", \t", &save_p)) {
+            if (config.hosts_size >= AS_CONFIG_HOSTS_SIZE) {
+                return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                        "Invalid cluster: Too many hosts");
+            }
+            if (AEROSPIKE_OK != ini_host_to_as_config_host(host_p,
+                        config.hosts[config.hosts_size], error)) {
+                return error.code;
+            }
             config.hosts_size++;
         }
-        if(AEROSPIKE_OK != verify_shm_key_store_it(config,error)) {
-            return error.code;
+
+        if (!config.hosts_size) {
+            return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                    "Invalid cluster: No hosts found");
         }
-        return error.code;
+        return verify_shm_key_store_it(config, error);
     }
 
     /*
@@ -699,7 +1429,7 @@ namespace HPHP {
      * @return true if associative. Otherwise false if indexed.
      *******************************************************************************************
      */
-    static bool is_assoc(Array& php_array)
+    static bool is_assoc(const Array& php_array)
     {
         uint16_t iter_count = 0;
         for (ArrayIter iter(php_array); iter; ++iter) {
@@ -714,7 +1444,59 @@ namespace HPHP {
 
     /*
      *******************************************************************************************
-     * Function to convert PHP variant into as_val
+     * Function to get the elements of a PHP Array or a Hack collection to be
+     * converted into an as_list or as_map.
+     * Vector, Map and Set collections share their storage with the returned
+     * Array instead of being copied into it. Maps are converted into as_map,
+     * and the other collections into as_list, whatever their keys.
+     *
+     * @param php_value     PHP Variant reference holding the Array or collection
+     * @param php_array     PHP Array reference to be set to its elements
+     * @param is_map        Set to true if it is to be converted into an as_map
+     * @return true if php_value is an Array or a collection. Otherwise false.
+     *******************************************************************************************
+     */
+    static bool php_container_to_array(const Variant& php_value, Array& php_array, bool& is_map)
+    {
+        if (php_value.isArray()) {
+            php_array = php_value.toCArrRef();
+            is_map = is_assoc(php_array);
+            return true;
+        }
+        if (!php_value.isObject() || !php_value.getObjectData()->isCollection()) {
+            return false;
+        }
+
+        ObjectData *collection_p = php_value.getObjectData();
+        switch (collection_p->getCollectionType()) {
+            case Collection::VectorType:
+            case Collection::ImmVectorType:
+                php_array = Array(static_cast<BaseVector *>(collection_p)->arrayData());
+                is_map = false;
+                break;
+            case Collection::MapType:
+            case Collection::ImmMapType:
+                php_array = Array(static_cast<BaseMap *>(collection_p)->arrayData());
+                is_map = true;
+                break;
+            case Collection::SetType:
+            case Collection::ImmSetType:
+                php_array = Array(static_cast<BaseSet *>(collection_p)->arrayData());
+                is_map = false;
+                break;
+            default:
+                php_array = php_value.toArray();
+                is_map = false;
+        }
+        return true;
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to convert a PHP Variant, which is not an Array or a collection,
+     * into as_val.
+     * Does not reset the error, as it is invoked for every element of the
+     * converted lists and maps.
      *
      * @param php_variant           PHP Variant reference that is to be converted
      * @param val_pp                as_val pointer to be allocated and populated by this function
@@ -728,49 +1510,55 @@ namespace HPHP {
      * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
      *******************************************************************************************
      */
-    as_status php_variant_to_as_val(const Variant& php_variant, as_val **val_pp, StaticPoolManager& static_pool,
-            int16_t serializer_type, as_error& error)
+    static as_status php_scalar_to_as_val(const Variant& php_variant, as_val **val_pp,
+            StaticPoolManager& static_pool, int16_t serializer_type, as_error& error)
     {
-        as_error_reset(&error);
-
-        if (!val_pp) {
-            return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
-                    "Variant value is null");
-        }
-
         if (php_variant.isInteger()) {
             if (NULL == (*val_pp = (as_val *) static_pool.get_as_integer())) {
                 return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
-                        "StaticPoolManager failed to allocate as_integer: Upper limit of size exceeded!")
+                        "StaticPoolManager failed to allocate as_integer: Memory allocation failed")
             }
             *val_pp = (as_val *) as_integer_init((as_integer *) *val_pp, (int64_t) php_variant.toInt64());
+        } else if (php_variant.isDouble() && ini_entry.native_doubles) {
+            if (NULL == (*val_pp = (as_val *) static_pool.get_as_double())) {
+                return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                        "StaticPoolManager failed to allocate as_double: Memory allocation failed")
+            }
+            *val_pp = (as_val *) as_double_init((as_double *) *val_pp, php_variant.toDouble());
+        } else if (php_variant.isBoolean() && ini_entry.native_booleans) {
+            if (NULL == (*val_pp = (as_val *) static_pool.get_as_integer())) {
+                return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                        "StaticPoolManager failed to allocate as_integer: Memory allocation failed")
+            }
+            *val_pp = (as_val *) as_integer_init((as_integer *) *val_pp, php_variant.toBoolean() ? 1 : 0);
         } else if (php_variant.isString()) {
             if (NULL == (*val_pp = (as_val *) static_pool.get_as_string())) {
                 return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
-                        "StaticPoolManager failed to allocate as_string: Upper limit of size exceeded!")
+                        "StaticPoolManager failed to allocate as_string: Memory allocation failed")
             }
-            *val_pp = (as_val *) as_string_init((as_string *) *val_pp, (char *) php_variant.toString().c_str(), false);
-        } else if (php_variant.isArray()) {
-            Array php_array = php_variant.toArray();
+            if (ini_entry.zero_copy_writes) {
+                const String& pinned_string = static_pool.pin_string(php_variant.toString());
 
-            if (is_assoc(php_array)) {
-                /* Handle map */
-                as_map *map_p = NULL;
-                if (AEROSPIKE_OK != php_map_to_as_map(php_array, &map_p, static_pool,
-                            serializer_type, error)) {
-                    return error.code;
-                }
-                *val_pp = (as_val *) map_p;
+                *val_pp = (as_val *) as_string_init_wlen((as_string *) *val_pp,
+                        (char *) pinned_string.c_str(), pinned_string.size(), false);
             } else {
-                /* Handle list */
-                as_list *list_p = NULL;
-                if (AEROSPIKE_OK != php_list_to_as_list(php_array, &list_p, static_pool,
-                            serializer_type, error)) {
-                    return error.code;
+                const String    php_string = php_variant.toString();
+                char            *copy_p = (char *) malloc(php_string.size() + 1);
+
+                if (NULL == copy_p) {
+                    return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                            "Unable to copy string value: Memory allocation failed");
                 }
-                *val_pp = (as_val *) list_p;
+                memcpy(copy_p, php_string.data(), php_string.size());
+                copy_p[php_string.size()] = '\0';
+                *val_pp = (as_val *) as_string_init_wlen((as_string *) *val_pp,
+                        copy_p, php_string.size(), true);
             }
         } else {
+            /*
+             * The serializers may replace the value they are given,
+             * so they get a copy of it.
+             */
             as_bytes    *bytes = NULL;
             Variant     temp_php_variant = php_variant;
             if (AEROSPIKE_OK != serialize_based_on_serializer_policy(serializer_type,
@@ -782,6 +1570,185 @@ namespace HPHP {
         return error.code;
     }
 
+    /*
+     *******************************************************************************************
+     * Function to allocate the as_list or as_map for a PHP Array from the
+     * StaticPoolManager, sized for the number of elements of the PHP Array.
+     *
+     * @param php_array             PHP Array reference, the container of which is to be allocated
+     * @param is_map                true to allocate an as_hashmap. Otherwise an as_arraylist.
+     * @param static_pool           StaticPoolManager instance reference, to be used for
+     *                              the conversion lifecycle.
+     * @param error                 as_error reference to be populated by this function
+     *                              in case of error
+     *
+     * @return the allocated as_list or as_map. Otherwise NULL.
+     *******************************************************************************************
+     */
+    static as_val* new_as_container(const Array& php_array, bool is_map,
+            StaticPoolManager& static_pool, as_error& error)
+    {
+        if (is_map) {
+            as_hashmap *map_p = static_pool.get_as_hashmap();
+            if (NULL == map_p) {
+                as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                        "StaticPoolManager failed to allocate as_hashmap: Memory allocation failed");
+                return NULL;
+            }
+            return (as_val *) as_hashmap_init(map_p, php_array.length());
+        }
+
+        as_arraylist *list_p = static_pool.get_as_arraylist(php_array.length());
+        if (NULL == list_p) {
+            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "StaticPoolManager failed to allocate as_arraylist: Memory allocation failed");
+        }
+        return (as_val *) list_p;
+    }
+
+    /*
+     *******************************************************************************************
+     * Structure declaration for php_to_as_frame.
+     * Holds a PHP Array, or the elements of a collection, being converted by
+     * php_array_to_as_container(), the
+     * position of its next element, and the as_list or as_map it is converted
+     * into.
+     *******************************************************************************************
+     */
+    typedef struct __php_to_as_frame {
+        Array       php_array;
+        ssize_t     pos;
+        as_val      *container_p;
+        bool        is_map;
+    } php_to_as_frame;
+
+    /*
+     *******************************************************************************************
+     * Function to convert a PHP Array into an already allocated as_list or as_map.
+     * Nested Arrays and collections are converted using an explicit stack of
+     * frames instead of
+     * recursion, so that the depth of a value is bounded by the
+     * aerospike.nesting_depth ini entry and not by the native stack.
+     * A nested as_list or as_map is added to its parent as soon as it is
+     * allocated, so that it is owned by the parent before being populated.
+     *
+     * @param php_array             PHP Array reference that is to be converted
+     * @param container_p           as_list or as_map to be populated by this function
+     * @param is_map                true if container_p is an as_map. Otherwise an as_list.
+     * @param static_pool           StaticPoolManager instance reference, to be used for
+     *                              the conversion lifecycle.
+     * @param serializer_type       The serializer_type to be used to handle
+     *                              the serialization.
+     * @param error                 as_error reference to be populated by this function
+     *                              in case of error
+     *
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    static as_status php_array_to_as_container(const Array& php_array, as_val *container_p,
+            bool is_map, StaticPoolManager& static_pool, int16_t serializer_type, as_error& error)
+    {
+        std::vector<php_to_as_frame>    stack;
+
+        stack.push_back({php_array, php_array.get()->iter_begin(), container_p, is_map});
+
+        while (!stack.empty()) {
+            php_to_as_frame&    frame = stack.back();
+            const ArrayData     *data_p = frame.php_array.get();
+
+            if (frame.pos == data_p->iter_end()) {
+                stack.pop_back();
+                continue;
+            }
+
+            ssize_t pos = frame.pos;
+            frame.pos = data_p->iter_advance(pos);
+
+            as_val *key_p = NULL;
+            if (frame.is_map && AEROSPIKE_OK != php_scalar_to_as_val(data_p->getKey(pos),
+                        &key_p, static_pool, serializer_type, error)) {
+                return error.code;
+            }
+
+            const Variant&  php_value = data_p->getValueRef(pos);
+            as_val          *val_p = NULL;
+            Array           php_child;
+            bool            is_child_map = false;
+            bool            is_child_container = php_container_to_array(php_value, php_child,
+                    is_child_map);
+
+            if (is_child_container) {
+                if ((int64_t) stack.size() >= ini_entry.nesting_depth) {
+                    as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                            "Nesting depth of the value exceeds aerospike.nesting_depth");
+                } else {
+                    val_p = new_as_container(php_child, is_child_map, static_pool, error);
+                }
+            } else {
+                php_scalar_to_as_val(php_value, &val_p, static_pool, serializer_type, error);
+            }
+
+            if (AEROSPIKE_OK != error.code) {
+                if (key_p) {
+                    as_val_destroy(key_p);
+                }
+                return error.code;
+            }
+
+            if (frame.is_map) {
+                as_map_set((as_map *) frame.container_p, key_p, val_p);
+            } else {
+                as_list_append((as_list *) frame.container_p, val_p);
+            }
+
+            if (is_child_container) {
+                stack.push_back({php_child, php_child.get()->iter_begin(), val_p, is_child_map});
+            }
+        }
+
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to convert PHP variant into as_val
+     *
+     * @param php_variant           PHP Variant reference that is to be converted
+     * @param val_pp                as_val pointer to be allocated and populated by this function
+     * @param static_pool           StaticPoolManager instance reference, to be used for
+     *                              the conversion lifecycle.
+     * @param serializer_type       The serializer_type to be used to handle
+     *                              the serialization.
+     * @param error                 as_error reference to be populated by this function
+     *                              in case of error
+     *
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status php_variant_to_as_val(const Variant& php_variant, as_val **val_pp, StaticPoolManager& static_pool,
+            int16_t serializer_type, as_error& error)
+    {
+        as_error_reset(&error);
+
+        if (!val_pp) {
+            return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Variant value is null");
+        }
+
+        Array   php_array;
+        bool    is_map = false;
+
+        if (!php_container_to_array(php_variant, php_array, is_map)) {
+            return php_scalar_to_as_val(php_variant, val_pp, static_pool, serializer_type, error);
+        }
+
+        if (NULL == (*val_pp = new_as_container(php_array, is_map, static_pool, error))) {
+            return error.code;
+        }
+        return php_array_to_as_container(php_array, *val_pp, is_map, static_pool,
+                serializer_type, error);
+    }
+
     /*
      *******************************************************************************************
      * Function to convert PHP list into as_list
@@ -809,24 +1776,13 @@ namespace HPHP {
         }
 
         if (NULL == *list_pp) {
-            if (NULL == (*list_pp = (as_list *) static_pool.get_as_arraylist())) {
-                return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
-                        "StaticPoolManager failed to allocate as_arraylist: Upper limit of size exceeded!")
-            }
-            *list_pp = (as_list *) as_arraylist_init((as_arraylist *) *list_pp, php_list.length(), 0);
-        }
-
-        for (ArrayIter iter(php_list); iter; ++iter) {
-            Variant php_value = iter.second();
-            as_val *val_p = NULL;
-            if (AEROSPIKE_OK != php_variant_to_as_val(php_value, &val_p, static_pool,
-                        serializer_type, error)) {
-                break;
+            if (NULL == (*list_pp = (as_list *) new_as_container(php_list, false, static_pool, error))) {
+                return error.code;
             }
-            as_list_append(*list_pp, val_p);
         }
 
-        return error.code;
+        return php_array_to_as_container(php_list, (as_val *) *list_pp, false, static_pool,
+                serializer_type, error);
     }
 
     /*
@@ -856,33 +1812,13 @@ namespace HPHP {
         }
 
         if (NULL == *map_pp) {
-            if (NULL == (*map_pp = (as_map *) static_pool.get_as_hashmap())) {
-                return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
-                        "StaticPoolManager failed to allocate as_hashmap: Upper limit of size exceeded!");
-            }
-            *map_pp = (as_map *) as_hashmap_init((as_hashmap *) *map_pp, php_map.length());
-        }
-
-        for (ArrayIter iter(php_map); iter; ++iter) {
-            Variant php_key = iter.first();
-            as_val *key_p = NULL;
-            if (AEROSPIKE_OK != php_variant_to_as_val(php_key, &key_p, static_pool, serializer_type,
-                        error)) {
-                break;
-            }
-            Variant php_value = iter.second();
-            as_val *val_p = NULL;
-            if (AEROSPIKE_OK != php_variant_to_as_val(php_value, &val_p, static_pool, serializer_type,
-                        error)) {
-                if (key_p) {
-                    as_val_destroy(key_p);
-                }
-                break;
+            if (NULL == (*map_pp = (as_map *) new_as_container(php_map, true, static_pool, error))) {
+                return error.code;
             }
-            as_map_set(*map_pp, key_p, val_p);
         }
 
-        return error.code;
+        return php_array_to_as_container(php_map, (as_val *) *map_pp, true, static_pool,
+                serializer_type, error);
     }
 
     /*
@@ -905,6 +1841,8 @@ namespace HPHP {
             StaticPoolManager& static_pool, int16_t serializer_type, as_error& error)
     {
         const char      *bin_name_p = NULL;
+        Array           php_array;
+        bool            is_map = false;
 
         as_error_reset(&error);
 
@@ -924,7 +1862,16 @@ namespace HPHP {
             }
             Variant value = iter.second();
             if (value.isString()) {
-                if (!as_record_set_str(&record, bin_name_p, value.toString().c_str())) {
+                /*
+                 * Same as the strings nested in lists and maps, so that
+                 * strings holding NUL bytes are written whole.
+                 */
+                as_val *string_p = NULL;
+                if (AEROSPIKE_OK != php_scalar_to_as_val(value, &string_p, static_pool,
+                            serializer_type, error)) {
+                    break;
+                }
+                if (!as_record_set_string(&record, bin_name_p, (as_string *) string_p)) {
                     return as_error_update(&error, AEROSPIKE_ERR_PARAM,
                         "Unable to set string value within as_record");
                 }
@@ -933,9 +1880,18 @@ namespace HPHP {
                     return as_error_update(&error, AEROSPIKE_ERR_PARAM,
                         "Unable to set integer value within as_record");
                 }
-            } else if (value.isArray()) {
-                Array php_array = value.toArray();
-                if (is_assoc(php_array)) {
+            } else if (value.isDouble() && ini_entry.native_doubles) {
+                if (!as_record_set_double(&record, bin_name_p, value.toDouble())) {
+                    return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                        "Unable to set double value within as_record");
+                }
+            } else if (value.isBoolean() && ini_entry.native_booleans) {
+                if (!as_record_set_int64(&record, bin_name_p, value.toBoolean() ? 1 : 0)) {
+                    return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                        "Unable to set boolean value within as_record");
+                }
+            } else if (php_container_to_array(value, php_array, is_map)) {
+                if (is_map) {
                     /* Handle map */
                     as_map *map_p = NULL;
                     if (AEROSPIKE_OK != php_map_to_as_map(php_array, &map_p, static_pool,
@@ -1026,6 +1982,14 @@ namespace HPHP {
                                 "Not expected an empty bin for increment operation");
                     }
 
+                    if (val.isDouble() && ini_entry.native_doubles) {
+                        if (!as_operations_add_incr_double(&operations, bin_p, val.toDouble())) {
+                            return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                                    "Unable to increment");
+                        }
+                        break;
+                    }
+
                     if (!val.isInteger()) {
                         return as_error_update(&error, AEROSPIKE_ERR_PARAM,
                                 "Invalid value type: expected an integer value for increment operation");
@@ -1144,62 +2108,287 @@ namespace HPHP {
         } else {
             set_operation(operations, op, bin_p, val, static_pool, ttl, serializer_type, error);
         }
-
+
+        return error.code;
+    }
+
+    as_status php_operations_to_as_operations(const Array& php_operations, as_operations& operations, StaticPoolManager& static_pool,
+            int16_t serializer_type, as_error& error)
+    {
+        as_error_reset(&error);
+
+        as_operations_init(&operations, php_operations.size());
+
+        for (ArrayIter iter(php_operations); iter; ++iter) {
+            Variant php_operation = iter.second();
+            if (!php_operation.isArray()) {
+                return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                        "Expecting each operation to be an array"); 
+            } else if (AEROSPIKE_OK != set_php_operation_within_as_operations(operations, php_operation.toArray(), static_pool,
+                        serializer_type, error)) {
+                break;
+            }
+        }
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to convert an as_val, which is not an as_list or an as_map, into
+     * PHP Variant.
+     * Does not reset the error, as it is invoked for every element of the
+     * converted lists and maps.
+     *
+     * @param value_p       as_val to be converted by this function
+     * @param php_value     PHP Variant reference to be populated by this
+     *                      function
+     * @param error         as_error reference to be populated by this function
+     *                      in case of error
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    static as_status as_scalar_to_php_variant(const as_val *value_p, Variant& php_value, as_error& error)
+    {
+        switch(as_val_type(value_p)) {
+            case AS_STRING:
+                {
+                    as_string *string_p = as_string_fromval(value_p);
+                    if (!string_p) {
+                        return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                                "String is null");
+                    }
+                    php_value = String(as_string_get(string_p), as_string_len(string_p), CopyString);
+                    break;
+                }
+            case AS_INTEGER:
+                {
+                    as_integer *integer_p = as_integer_fromval(value_p);
+                    if (!integer_p) {
+                        return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                                "Integer is null");
+                    }
+                    php_value = as_integer_get(integer_p);
+                    break;
+                }
+            case AS_DOUBLE:
+                {
+                    as_double *double_p = as_double_fromval(value_p);
+                    if (!double_p) {
+                        return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                                "Double is null");
+                    }
+                    php_value = as_double_get(double_p);
+                    break;
+                }
+            case AS_BYTES:
+                {
+                    unserialize_based_on_as_bytes_type((as_bytes *) value_p,
+                            php_value, error);
+                    break;
+                }
+            case AS_REC:
+                {
+                    as_record *record_p = as_record_fromval(value_p);
+                    as_record_to_php_record(record_p, NULL, (Array& )php_value, NULL, error);
+                    break;
+                }
+            case AS_NIL:
+                {
+                    break;
+                }
+            default:
+                {
+                    as_error_update(&error, AEROSPIKE_ERR_CLIENT, "Unsupported Datatype for Bin");
+                }
+        }
         return error.code;
     }
 
-    as_status php_operations_to_as_operations(const Array& php_operations, as_operations& operations, StaticPoolManager& static_pool,
-            int16_t serializer_type, as_error& error)
-    {
-        as_error_reset(&error);
-
-        as_operations_init(&operations, php_operations.size());
+    /*
+     *******************************************************************************************
+     * Structure declaration for as_to_php_frame.
+     * Holds the PHP Array being populated by as_container_to_php_variant() for
+     * an as_list (walked by index) or an as_map (walked by iterator), and the
+     * key to set the PHP Array at within the parent PHP map.
+     *******************************************************************************************
+     */
+    typedef struct __as_to_php_frame {
+        Array           php_array;
+        const as_list   *list_p;
+        uint32_t        index;
+        uint32_t        size;
+        as_iterator     *map_iter_p;
+        Variant         php_key;
+    } as_to_php_frame;
 
-        for (ArrayIter iter(php_operations); iter; ++iter) {
-            Variant php_operation = iter.second();
-            if (!php_operation.isArray()) {
-                return as_error_update(&error, AEROSPIKE_ERR_PARAM,
-                        "Expecting each operation to be an array"); 
-            } else if (AEROSPIKE_OK != set_php_operation_within_as_operations(operations, php_operation.toArray(), static_pool,
-                        serializer_type, error)) {
-                break;
+    /*
+     *******************************************************************************************
+     * Function to push the frame for an as_list or as_map on the stack of
+     * as_container_to_php_variant(). The PHP Array of the frame is reserved for
+     * the size of the as_list or as_map, so that it never grows while being
+     * populated.
+     *
+     * @param stack         The stack of frames to be pushed on
+     * @param container_p   as_list or as_map to be converted
+     * @param php_key       The key to set the PHP Array at within the parent PHP map
+     * @param error         as_error reference to be populated by this function
+     *                      in case of error
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    static as_status push_as_to_php_frame(std::vector<as_to_php_frame>& stack,
+            const as_val *container_p, const Variant& php_key, as_error& error)
+    {
+        if (AS_LIST == as_val_type(container_p)) {
+            const as_list *list_p = as_list_fromval((as_val *) container_p);
+            if (!list_p) {
+                return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                        "List is null");
+            }
+            uint32_t size = as_list_size((as_list *) list_p);
+            stack.push_back({Array::attach(PackedArray::MakeReserve(size)), list_p, 0, size,
+                    NULL, php_key});
+        } else {
+            const as_map *map_p = as_map_fromval((as_val *) container_p);
+            if (!map_p) {
+                return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                        "Map is null");
+            }
+            as_iterator *map_iter_p = as_map_iterator_new(map_p);
+            if (!map_iter_p) {
+                return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                        "Unable to iterate the map: Memory allocation failed");
             }
+            stack.push_back({Array::attach(MixedArray::MakeReserveMixed(
+                            as_map_size((as_map *) map_p))), NULL, 0, 0, map_iter_p, php_key});
         }
         return error.code;
     }
 
     /*
      *******************************************************************************************
-     * Callback function for each as_list element
-     * Appends corresponding PHP value for current as_value (element of the
-     * as_list) to the PHP list passed within udata_p
+     * Function to convert an as_list or as_map into PHP Variant.
+     * Nested lists and maps are converted using an explicit stack of frames
+     * instead of recursion, so that the depth of a value is bounded by the
+     * aerospike.nesting_depth ini entry and not by the native stack.
+     * A nested PHP Array is added to its parent once it is fully populated,
+     * which keeps the order of the elements, as the elements following it are
+     * only converted afterwards. Within a CollectionsScope requesting them,
+     * lists are returned as HH\Vector and maps as HH\Map collections instead.
      *
-     * @param value_p       An as_val list element
-     * @param udata_p       foreach_callback_udata pointer which wraps us the PHP list
-     *                      to be appended to by this function and as_error reference
-     *                      to be populated in case of error.
+     * @param container_p   as_list or as_map to be converted by this function
+     * @param php_value     PHP Variant reference to be populated by this
+     *                      function
+     * @param error         as_error reference to be populated by this function
+     *                      in case of error
      * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
      *******************************************************************************************
      */
-    static bool list_to_php_list_foreach_callback(as_val *value_p, void *udata_p)
+    static as_status as_container_to_php_variant(const as_val *container_p, Variant& php_value,
+            as_error& error)
     {
-        if (!value_p) {
-            return false;
-        }
+        std::vector<as_to_php_frame>    stack;
+        Variant                         php_key;
+        Variant                         php_element;
 
-        foreach_callback_udata *conversion_data_p = (foreach_callback_udata *) udata_p;
-        Variant php_value;
-        if (AEROSPIKE_OK != as_val_to_php_variant(value_p, php_value, conversion_data_p->error)) {
-            return false;
+        push_as_to_php_frame(stack, container_p, php_key, error);
+
+        while (AEROSPIKE_OK == error.code && !stack.empty()) {
+            as_to_php_frame&    frame = stack.back();
+            const as_val        *key_p = NULL;
+            const as_val        *value_p = NULL;
+
+            if (frame.list_p) {
+                if (frame.index < frame.size) {
+                    value_p = as_list_get(frame.list_p, frame.index++);
+                    if (!value_p) {
+                        as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                                "List element is null");
+                        break;
+                    }
+                }
+            } else if (as_iterator_has_next(frame.map_iter_p)) {
+                const as_pair *pair_p = as_pair_fromval(as_iterator_next(frame.map_iter_p));
+                if (pair_p) {
+                    key_p = as_pair_1((as_pair *) pair_p);
+                    value_p = as_pair_2((as_pair *) pair_p);
+                }
+                if (!key_p || !value_p) {
+                    as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                            "Map entry is null");
+                    break;
+                }
+            }
+
+            if (!value_p) {
+                /*
+                 * The frame is fully populated, set its PHP Array (or the
+                 * collection made of it) within the parent, or return it if
+                 * it is the outermost one.
+                 */
+                Variant php_container;
+                if (CollectionsScope::requested()) {
+                    php_container = create_object(frame.list_p ? s_HH_Vector : s_HH_Map,
+                            make_packed_array(frame.php_array));
+                } else {
+                    php_container = std::move(frame.php_array);
+                }
+                php_key = std::move(frame.php_key);
+                if (frame.map_iter_p) {
+                    as_iterator_destroy(frame.map_iter_p);
+                }
+                stack.pop_back();
+
+                if (stack.empty()) {
+                    php_value = std::move(php_container);
+                } else if (stack.back().list_p) {
+                    stack.back().php_array.append(php_container);
+                } else {
+                    stack.back().php_array.set(php_key, php_container);
+                }
+                continue;
+            }
+
+            php_key.setNull();
+            if (key_p && AEROSPIKE_OK != as_scalar_to_php_variant(key_p, php_key, error)) {
+                break;
+            }
+
+            as_val_t value_type = as_val_type(value_p);
+            if (AS_LIST == value_type || AS_MAP == value_type) {
+                if ((int64_t) stack.size() >= ini_entry.nesting_depth) {
+                    as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                            "Nesting depth of the value exceeds aerospike.nesting_depth");
+                    break;
+                }
+                push_as_to_php_frame(stack, value_p, php_key, error);
+                continue;
+            }
+
+            php_element.setNull();
+            if (AEROSPIKE_OK != as_scalar_to_php_variant(value_p, php_element, error)) {
+                break;
+            }
+            if (frame.list_p) {
+                frame.php_array.append(php_element);
+            } else {
+                frame.php_array.set(php_key, php_element);
+            }
         }
 
-        conversion_data_p->data.append(php_value);
-        return true;
+        for (auto& remaining_frame : stack) {
+            if (remaining_frame.map_iter_p) {
+                as_iterator_destroy(remaining_frame.map_iter_p);
+            }
+        }
+        return error.code;
     }
 
     /*
      *******************************************************************************************
      * Function to convert as_list into PHP list
+     * The PHP list is built as a packed array reserved for the size of the
+     * as_list, so that it never grows while being appended to.
      *
      * @param list_p        as_list to be converted by this function
      * @param php_list      PHP Variant reference to be populated by this
@@ -1216,51 +2405,14 @@ namespace HPHP {
             return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "List is null");
         }
-        Array                       temp_php_list = Array::Create();
-        foreach_callback_udata      udata(temp_php_list, error);
-        as_list_foreach(list_p, (as_list_foreach_callback) list_to_php_list_foreach_callback, &udata);
-        php_list = temp_php_list;
-        return error.code;
-    }
-
-    /*
-     *******************************************************************************************
-     * Callback function for each as_map element
-     * Sets corresponding PHP values for current as_values (key and value of the
-     * as_map) within the PHP map passed within udata_p
-     *
-     * @param key_p         An as_val map key
-     * @param value_p       An as_val map value
-     * @param udata_p       foreach_callback_udata pointer which wraps us the PHP map
-     *                      to be set by this function and as_error reference
-     *                      to be populated in case of error.
-     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
-     *******************************************************************************************
-     */
-    static bool map_to_php_map_foreach_callback(as_val *key_p, as_val *value_p, void *udata_p)
-    {
-        if (!key_p || !value_p) {
-            return false;
-        }
-
-        foreach_callback_udata *conversion_data_p = (foreach_callback_udata *) udata_p;
-        Variant php_key;
-        if (AEROSPIKE_OK != as_val_to_php_variant(key_p, php_key, conversion_data_p->error)) {
-            return false;
-        }
-
-        Variant php_value;
-        if (AEROSPIKE_OK != as_val_to_php_variant(value_p, php_value, conversion_data_p->error)) {
-            return false;
-        }
-
-        conversion_data_p->data.set(php_key, php_value);
-        return true;
+        return as_container_to_php_variant((const as_val *) list_p, php_list, error);
     }
 
     /*
      *******************************************************************************************
      * Function to convert as_map into PHP map
+     * The PHP map is reserved for the size of the as_map, so that it is never
+     * rehashed while being set.
      *
      * @param map_p         as_map to be converted by this function
      * @param php_map       PHP Variant reference to be populated by this
@@ -1277,11 +2429,7 @@ namespace HPHP {
             return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Map is null");
         }
-        Array                       temp_php_map = Array::Create();
-        foreach_callback_udata      udata(temp_php_map, error);
-        as_map_foreach(map_p, (as_map_foreach_callback) map_to_php_map_foreach_callback, &udata);
-        php_map = temp_php_map;
-        return error.code;
+        return as_container_to_php_variant((const as_val *) map_p, php_map, error);
     }
 
     /*
@@ -1300,61 +2448,32 @@ namespace HPHP {
     {
         as_error_reset(&error);
 
-        switch(as_val_type(value_p)) {
-            case AS_STRING:
-                {
-                    as_string *string_p = as_string_fromval(value_p);
-                    if (!string_p) {
-                        return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
-                                "String is null");
-                    }
-                    php_value = String(as_string_get(string_p));
-                    break;
-                }
-            case AS_INTEGER:
-                {
-                    as_integer *integer_p = as_integer_fromval(value_p);
-                    if (!integer_p) {
-                        return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
-                                "Integer is null");
-                    }
-                    php_value = as_integer_get(integer_p);
-                    break;
-                }
-            case AS_BYTES:
-                {
-                    unserialize_based_on_as_bytes_type((as_bytes *) value_p,
-                            php_value, error);
-                    break;
-                }
-            case AS_LIST:
-                {
-                    as_list *list_p = as_list_fromval((as_val *) value_p);
-                    as_list_to_php_list(list_p, php_value, error);
-                    break;
-                }
-            case AS_MAP:
-                {
-                    as_map *map_p = as_map_fromval((as_val *) value_p);
-                    as_map_to_php_map(map_p, php_value, error);
-                    break;
-                }
-            case AS_REC:
-                {
-                    as_record *record_p = as_record_fromval(value_p);
-                    as_record_to_php_record(record_p, NULL, (Array& )php_value, NULL, error);
-                    break;
-                }
-            case AS_NIL:
-                {
-                    break;
-                }
-            default:
-                {
-                    as_error_update(&error, AEROSPIKE_ERR_CLIENT, "Unsupported Datatype for Bin");
-                }
+        as_val_t value_type = as_val_type(value_p);
+        if (AS_LIST == value_type || AS_MAP == value_type) {
+            return as_container_to_php_variant(value_p, php_value, error);
         }
-        return error.code;
+        return as_scalar_to_php_variant(value_p, php_value, error);
+    }
+
+    /*
+     *******************************************************************************************
+     * Method to get the interned PHP string for a bin name, interning it on
+     * first use. The string is a static string, so it is not allocated on
+     * the heap of the thread converting the record.
+     *
+     * @param bin_name_p    The bin name
+     *
+     * @return the PHP string shared by all uses of the bin name.
+     *******************************************************************************************
+     */
+    const String& BinNameTable::intern(const char *bin_name_p)
+    {
+        auto it = bin_names.find(bin_name_p);
+        if (it == bin_names.end()) {
+            it = bin_names.emplace(bin_name_p,
+                    String(makeStaticString(bin_name_p))).first;
+        }
+        return it->second;
     }
 
     /*
@@ -1384,23 +2503,31 @@ namespace HPHP {
             return false;
         }
 
-        conversion_data_p->data.set(String(name_p), php_value);
+        if (conversion_data_p->bin_names_p) {
+            conversion_data_p->data.set(conversion_data_p->bin_names_p->intern(name_p), php_value);
+        } else {
+            conversion_data_p->data.set(String(name_p), php_value);
+        }
         return true;
     }
 
     /*
      *******************************************************************************************
      * Function to convert bins of as_record into PHP bins Array
+     * An empty PHP bins Array is replaced by one reserved for the number of
+     * bins of the record.
      *
      * @param record_p      as_record, the bins of which are to be converted by this function
      * @param php_bins      PHP Array reference to be populated by this
      *                      function
      * @param error         as_error reference to be populated by this function
      *                      in case of error
+     * @param bin_names_p   Optional table to intern the bin names in
      * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
      *******************************************************************************************
      */
-    as_status bins_to_php_bins(const as_record *record_p, Array& php_bins, as_error& error)
+    as_status bins_to_php_bins(const as_record *record_p, Array& php_bins, as_error& error,
+            BinNameTable *bin_names_p)
     {
         as_error_reset(&error);
 
@@ -1409,7 +2536,11 @@ namespace HPHP {
                     "Record is null");
         }
 
-        foreach_callback_udata      udata(php_bins, error);
+        if (php_bins.empty()) {
+            php_bins = Array::attach(MixedArray::MakeReserveMixed(record_p->bins.size));
+        }
+
+        foreach_callback_udata      udata(php_bins, error, bin_names_p);
         as_record_foreach(record_p, (as_rec_foreach_callback) bins_to_php_bins_foreach_callback, &udata);
 
         return error.code;
@@ -1451,7 +2582,7 @@ namespace HPHP {
      * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
      *******************************************************************************************
      */
-    static as_status as_key_to_php_key(const as_key *key_p, Array& php_key, as_policy_key *key_policy_p,
+    as_status as_key_to_php_key(const as_key *key_p, Array& php_key, as_policy_key *key_policy_p,
             as_error& error)
     {
         as_error_reset(&error);
@@ -1513,11 +2644,12 @@ namespace HPHP {
      *                      function
      * @param error         as_error reference to be populated by this function
      *                      in case of error
+     * @param bin_names_p   Optional table to intern the bin names in
      * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
      *******************************************************************************************
      */
     as_status as_record_to_php_record(const as_record *record_p, const as_key *key_p, Array& php_record,
-            as_policy_key *key_policy_p, as_error& error)
+            as_policy_key *key_policy_p, as_error& error, BinNameTable *bin_names_p)
     {
         as_error_reset(&error);
         if (!record_p) {
@@ -1525,17 +2657,138 @@ namespace HPHP {
                     "Record is null");
         }
 
+        DeserializerBatch deserializer_batch;
+        deserializer_batch.add_record(record_p);
+        if (AEROSPIKE_OK != deserializer_batch.deserialize(error)) {
+            return error.code;
+        }
+
         Array php_key = Array::Create();
         Array php_metadata = Array::Create();
         Array php_bins = Array::Create();
 
         as_key_to_php_key(key_p ? key_p : &record_p->key, php_key, key_policy_p, error);
         metadata_to_php_metadata(record_p, php_metadata, error);
-        bins_to_php_bins(record_p, php_bins, error);
+        bins_to_php_bins(record_p, php_bins, error, bin_names_p);
 
         php_record.set(s_key, php_key);
         php_record.set(s_metadata, php_metadata);
         php_record.set(s_bins, php_bins);
         return error.code;
     }
+
+    /*
+     *******************************************************************************************
+     * Function to check whether OPT_COLLECTIONS is set within the options of a
+     * read call
+     *
+     * @param options           The options of the read call
+     *
+     * @return true if lists and maps are to be read as collections.
+     *******************************************************************************************
+     */
+    bool is_collections_requested(const Variant& options)
+    {
+        return options.isArray() && options.toArray().exists(OPT_COLLECTIONS) &&
+            options.toArray()[OPT_COLLECTIONS].toBoolean();
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to check whether OPT_DECODE_JSON is set within the options of a
+     * read call
+     *
+     * @param options           The options of the read call
+     *
+     * @return true if blobs are to be decoded as the JSON of SERIALIZER_JSON.
+     *******************************************************************************************
+     */
+    bool is_decode_json_requested(const Variant& options)
+    {
+        return options.isArray() && options.toArray().exists(OPT_DECODE_JSON) &&
+            options.toArray()[OPT_DECODE_JSON].toBoolean();
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to get the bin names hinted as booleans by OPT_BOOLEAN_BINS
+     *
+     * @param options           The options of the read call
+     * @param boolean_bins      Array to be populated with the hinted bin names
+     * @param error             as_error reference to be populated by this function
+     *                          in case of error
+     *
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status get_boolean_bins_hint(const Variant& options, Array& boolean_bins, as_error& error)
+    {
+        as_error_reset(&error);
+
+        if (!options.isArray() || !options.toArray().exists(OPT_BOOLEAN_BINS)) {
+            return error.code;
+        }
+
+        Variant hint = options.toArray()[OPT_BOOLEAN_BINS];
+        if (!hint.isArray()) {
+            return as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                    "OPT_BOOLEAN_BINS must be an array of bin names");
+        }
+        boolean_bins = hint.toArray();
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to convert the integer bins hinted as booleans back into
+     * booleans, within the bins of a PHP record
+     *
+     * @param boolean_bins      The bin names hinted as booleans
+     * @param php_record        The PHP record holding the bins
+     *******************************************************************************************
+     */
+    void apply_boolean_bins_hint(const Array& boolean_bins, Array& php_record)
+    {
+        if (boolean_bins.empty() || !php_record.exists(s_bins) ||
+                !php_record[s_bins].isArray()) {
+            return;
+        }
+
+        Array php_bins = php_record[s_bins].toArray();
+        for (ArrayIter iter(boolean_bins); iter; ++iter) {
+            Variant bin_name = iter.second();
+            if (php_bins.exists(bin_name) && php_bins[bin_name].isInteger()) {
+                php_bins.set(bin_name, php_bins[bin_name].toBoolean());
+            }
+        }
+        php_record.set(s_bins, php_bins);
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to convert the integer bins hinted as booleans back into
+     * booleans, within every record of a batch result. Aerospike\Record
+     * objects keep the hint, to convert the bins on access.
+     *
+     * @param boolean_bins      The bin names hinted as booleans
+     * @param php_records       The PHP records of the batch result
+     *******************************************************************************************
+     */
+    void apply_boolean_bins_hint_to_records(const Array& boolean_bins, Array& php_records)
+    {
+        if (boolean_bins.empty()) {
+            return;
+        }
+
+        Array batch_records = php_records;
+        for (ArrayIter iter(batch_records); iter; ++iter) {
+            if (iter.second().isArray()) {
+                Array php_record = iter.second().toArray();
+                apply_boolean_bins_hint(boolean_bins, php_record);
+                php_records.set(iter.first(), php_record);
+            } else {
+                apply_boolean_bins_hint_to_lazy_record(boolean_bins, iter.second());
+            }
+        }
+    }
 } // namespace HPHP
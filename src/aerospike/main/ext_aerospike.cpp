@@ -7,21 +7,27 @@
 #include "ext_aerospike.h"
 #include "policy.h"
 #include "batch_op_manager.h"
+#include "batch_write_manager.h"
+#include "batch_read_manager.h"
 #include "scan_operation.h"
 #include "udf_operations.h"
+#include "connection_registry.h"
+#include "lazy_record.h"
 
 #include "hphp/runtime/base/builtin-functions.h"
 #include "aerospike/as_bytes.h"
 #include "hphp/runtime/vm/vm-regs.h"
 
+#include <mutex>
+#include <thread>
+
 namespace HPHP {
 
     /*
      * Aerospike extension globals
      */
-    std::unordered_map<std::string, aerospike_ref *> persistent_list;
-    pthread_rwlock_t connection_mutex;
     pthread_rwlock_t scan_query_callback_mutex;
+    static std::once_flag prewarm_once_flag;
 
 	ini_entries ini_entry;
 
@@ -32,6 +38,7 @@ namespace HPHP {
     Variant Aerospike::deserializer;
     int Aerospike::is_serializer_registered = 0;
     int Aerospike::is_deserializer_registered = 0;
+    int Aerospike::is_deserializer_batched = 0;
 
     /*
      ************************************************************************************
@@ -47,7 +54,22 @@ namespace HPHP {
      */
     Aerospike::Aerospike() 
     {
-        pthread_rwlock_init(&latest_error_mutex, NULL);
+        as_error_init(&latest_error);
+    }
+
+    /*
+     ************************************************************************************
+     * Function to record the outcome of the latest operation.
+     * On success only the status code is recorded, the message, func, file and
+     * line are only copied when the operation failed.
+     ************************************************************************************
+     */
+    void Aerospike::set_latest_error(const as_error& error)
+    {
+        latest_error_code = error.code;
+        if (error.code != AEROSPIKE_OK) {
+            as_error_copy(&latest_error, &error);
+        }
     }
 
     /*
@@ -65,173 +87,357 @@ namespace HPHP {
 
         if (as_ref_p) {
             if (is_connected) {
-                pthread_rwlock_wrlock(&connection_mutex);
                 as_ref_p->ref_php_object--;
-                pthread_rwlock_unlock(&connection_mutex);
                 is_connected = false;
 
                 if (!is_persistent) {
                     aerospike_close(as_ref_p->as_p, &error);
                     aerospike_destroy(as_ref_p->as_p);
                     as_ref_p->as_p = NULL;
-                    free(as_ref_p);
+                    delete as_ref_p;
                 }
             } else {
                 if (!is_persistent) {
                     aerospike_destroy(as_ref_p->as_p);
                     as_ref_p->as_p = NULL;
-                    free(as_ref_p);
+                    delete as_ref_p;
                 }
             }
             as_ref_p = NULL;
         }
+        is_connect_deferred = false;
+        /*
+         * At the end of the request the request heap is swept as a whole,
+         * so the arrays are dropped without a decref.
+         */
+        deferred_config.releaseForSweep();
+        deferred_options.releaseForSweep();
     }
 
     /*
      ************************************************************************************
      * Destructor
+     * Runs within the request, so the deferred config and options are
+     * released with a decref, unlike the end of request sweep which only
+     * drops them.
      ************************************************************************************
      */
     Aerospike::~Aerospike()
     {
+        deferred_config = init_null();
+        deferred_options = init_null();
         sweep();
     }
 
     /*
      ************************************************************************************
-     * This macro will create key in the unordered_map.
-     * Which is host_entry => address:port.
+     * This function will create new host entry.
+     * Initialize it's fields with the appropriate values.
      ************************************************************************************
      */
-#define CREATE_NEW_ALIAS(iter_hosts)                                             \
-    if (config.hosts_size) {                                                     \
-        alias_to_search = (char*) malloc(strlen(config.hosts[iter_hosts].addr) + \
-                MAX_PORT_SIZE + 1);                                              \
-        strcpy(alias_to_search, config.hosts[iter_hosts].addr);                  \
-        strcat(alias_to_search, ":");                                            \
-        sprintf(port , "%d", config.hosts[iter_hosts].port);                     \
-        strcat(alias_to_search, port);                                           \
+    void Aerospike::create_new_host_entry(as_config& config, as_error& error)
+    {
+        as_ref_p = new (std::nothrow) aerospike_ref();
+        if (as_ref_p == NULL) {
+            as_error_update(&error, AEROSPIKE_ERR_CLIENT, "memory allocation failed");
+            return;
+        }
+        as_ref_p->ref_host_entry = 0;
+        as_ref_p->ref_php_object = 1;
+        as_ref_p->bind_count = 1;
+        as_ref_p->as_p = aerospike_new(&config);
     }
 
     /*
      ************************************************************************************
-     * This function will iterate over remaining list of hosts and hash them
-     * into the persistent list, each pointing to the same aerospike ref object.
-     * Increment corresponding ref_host_entry within the aerospike_ref object.
+     * This function will close and destroy the C client's aerospike object of
+     * a host entry which is not referred by any PHP object anymore, as well as
+     * the other instances it keeps for the cluster.
      ************************************************************************************
      */
-    void Aerospike::iterate_hosts_add_entry(as_config& config, int matched_host_id) {
-        char                *alias_to_search = NULL;
-        char                port[MAX_PORT_SIZE];
-        int                 iter_hosts;
+    static void destroy_host_entry(aerospike_ref *host_entry)
+    {
+        as_error            error;
 
-        for (iter_hosts = 0; iter_hosts < config.hosts_size; iter_hosts++) {
-            if (iter_hosts == matched_host_id) {
-                continue;
-            }
-            CREATE_NEW_ALIAS(iter_hosts);
-            /*
-             * Write lock is required as we are modifying as_ref_p and which is
-             * pointing to one of the entry in the persistent_list.
-             */
-            pthread_rwlock_wrlock(&connection_mutex);
-            as_ref_p->ref_host_entry++;
-            persistent_list[alias_to_search] = as_ref_p;
-            pthread_rwlock_unlock(&connection_mutex);
-
-            if (alias_to_search) {
-                free(alias_to_search);
-                alias_to_search = NULL;
+        as_error_init(&error);
+
+        for (auto instance_p : host_entry->instances) {
+            if (instance_p != host_entry) {
+                destroy_host_entry(instance_p);
             }
         }
+        if (host_entry->as_p) {
+            aerospike_close(host_entry->as_p, &error);
+            aerospike_destroy(host_entry->as_p);
+            host_entry->as_p = NULL;
+        }
+        delete host_entry;
     }
 
     /*
      ************************************************************************************
-     * This function will create new host entry.
-     * Initialize it's fields with the appropriate values.
+     * This function will create a new host entry with a connected C client's
+     * aerospike object.
      ************************************************************************************
      */
-    void Aerospike::create_new_host_entry(as_config& config, as_error& error)
+    static aerospike_ref* create_connected_host_entry(as_config& config, as_error& error)
     {
-        as_ref_p = (aerospike_ref *) malloc(sizeof(aerospike_ref));
-        if (as_ref_p == NULL) {
+        aerospike_ref       *new_entry = NULL;
+
+        new_entry = new (std::nothrow) aerospike_ref();
+        if (new_entry == NULL) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT, "memory allocation failed");
-            return;
+            return NULL;
         }
-        as_ref_p->as_p = NULL;
-        as_ref_p->ref_host_entry = 0;
-        as_ref_p->ref_php_object = 1;
-        as_ref_p->as_p = aerospike_new(&config);
+        new_entry->as_p = aerospike_new(&config);
+
+        if (AEROSPIKE_OK != aerospike_connect(new_entry->as_p, &error)) {
+            as_error_update(&error, AEROSPIKE_ERR_CLUSTER,
+                    "Unable to connect to server");
+            aerospike_destroy(new_entry->as_p);
+            delete new_entry;
+            return NULL;
+        }
+        return new_entry;
+    }
+
+    /*
+     ************************************************************************************
+     * This function will create a new connected host entry for the cluster and
+     * publish it in the persistent list.
+     * The entry keeps aerospike.connection.instances C client's aerospike
+     * objects for the cluster, each of them having its own cluster tending
+     * and node connection pools. With shared memory cluster tending, the
+     * instances would share the same shm_key, so a single one is kept.
+     * If another request thread has published an entry for the same cluster
+     * id meanwhile, the new entry is dropped and the published one is returned.
+     * The returned entry is not yet referred by any PHP object.
+     ************************************************************************************
+     */
+    static aerospike_ref* publish_new_host_entry(as_config& config,
+            uint64_t cluster_id, as_error& error)
+    {
+        aerospike_ref       *host_entry = NULL;
+        aerospike_ref       *new_entry = NULL;
+        aerospike_ref       *instance_p = NULL;
+        int64_t             instances_count = ini_entry.connection_instances;
+        bool                inserted = false;
+
+        as_error_reset(&error);
+
+        if (config.use_shm) {
+            instances_count = 1;
+        }
+
+        /*
+         * Connect before publishing the entry, so that other request
+         * threads never pick up a connection which is not yet up.
+         */
+        new_entry = create_connected_host_entry(config, error);
+        if (!new_entry) {
+            return NULL;
+        }
+        new_entry->instances.push_back(new_entry);
+        for (int64_t iter = 1; iter < instances_count; iter++) {
+            instance_p = create_connected_host_entry(config, error);
+            if (!instance_p) {
+                destroy_host_entry(new_entry);
+                return NULL;
+            }
+            instance_p->primary_p = new_entry;
+            new_entry->instances.push_back(instance_p);
+        }
+        create_cluster_alias(config, new_entry->cluster_alias);
+
+        host_entry = persistent_list.insert_if_absent(cluster_id, new_entry,
+                inserted);
+
+        if (inserted) {
+            new_entry->ref_host_entry++;
+        } else {
+            destroy_host_entry(new_entry);
+        }
+
+        return host_entry;
+    }
+
+    /*
+     ************************************************************************************
+     * This function will select the instance of the host entry to be used by
+     * the current request thread. The selection is by thread id, so that each
+     * request thread keeps using the same C client's aerospike object.
+     ************************************************************************************
+     */
+    static aerospike_ref* select_host_instance(aerospike_ref *host_entry)
+    {
+        size_t              instances_size = host_entry->instances.size();
+
+        if (instances_size <= 1) {
+            return host_entry;
+        }
+        return host_entry->instances[
+            std::hash<std::thread::id>()(std::this_thread::get_id()) % instances_size];
     }
 
     /*
      ************************************************************************************
      * This function will configure the connection.
-     * i.e. Creating new host entry in the persistent list, If host is not present.
-     * And reuse the same connection if hot is already present in the persistent list.
+     * i.e. Creating new entry in the persistent list, If the cluster is not present.
+     * And reuse the same connection if the cluster is already present in the
+     * persistent list. The cluster is identified by get_cluster_id(), so that
+     * the lookup is a single hash probe without any allocation.
      ************************************************************************************
      */
     as_status Aerospike::configure_connection(as_config& config, as_error& error)
     {
-        char                *alias_to_search = NULL;
-        char                port[MAX_PORT_SIZE];
-        int                 iter_hosts;
-        int                 matched_host_id = -1;
+        uint64_t            cluster_id;
         aerospike_ref       *host_entry = NULL;
 
         as_error_reset(&error);
 
         if (is_persistent) {
-            for (iter_hosts = 0; iter_hosts < config.hosts_size; iter_hosts++) {
-                CREATE_NEW_ALIAS(iter_hosts);
-                pthread_rwlock_rdlock(&connection_mutex);
-                if (persistent_list[alias_to_search] != nullptr) {
-                    host_entry = persistent_list[alias_to_search];
-                    as_ref_p = host_entry;
-                    pthread_rwlock_unlock(&connection_mutex);
-                    is_connected = true;
-                    pthread_rwlock_wrlock(&connection_mutex);
-                    host_entry->ref_php_object++;
-                    pthread_rwlock_unlock(&connection_mutex);
-                    matched_host_id = iter_hosts;
-                    iterate_hosts_add_entry(config, matched_host_id);
-                } else {
-                    pthread_rwlock_unlock(&connection_mutex);
-                }
+            cluster_id = get_cluster_id(config);
+            host_entry = persistent_list.find(cluster_id);
 
-                if (alias_to_search) {
-                    free(alias_to_search);
-                    alias_to_search = NULL;
-                }
-                if (matched_host_id != -1) {
+            if (!host_entry) {
+                host_entry = publish_new_host_entry(config, cluster_id, error);
+                if (!host_entry) {
                     return error.code;
                 }
             }
 
-            CREATE_NEW_ALIAS(0);
-            create_new_host_entry(config, error);
-            if (error.code == AEROSPIKE_OK) {
-                as_ref_p->ref_host_entry++;
-                host_entry = as_ref_p;
-                pthread_rwlock_wrlock(&connection_mutex);
-                persistent_list[alias_to_search] = host_entry;
-                pthread_rwlock_unlock(&connection_mutex);
-
-                if (alias_to_search) {
-                    free(alias_to_search);
-                    alias_to_search = NULL;
-                }
+            if (is_same_cluster(config, host_entry->cluster_alias)) {
+                as_ref_p = select_host_instance(host_entry);
+                is_connected = true;
+                as_ref_p->ref_php_object++;
+                as_ref_p->bind_count++;
+                return error.code;
+            }
+
+            /*
+             * Cluster id collision with a different cluster, fall back to
+             * a non persistent connection.
+             */
+            is_persistent = false;
+        }
+
+        create_new_host_entry(config, error);
+        return error.code;
+    }
+
+    /*
+     ************************************************************************************
+     * This function will connect the clusters declared by the
+     * aerospike.prewarm.clusters ini setting and place them in the persistent
+     * list, so that the first request constructing an Aerospike object with a
+     * matching config does not pay for the cluster connection.
+     * Clusters are separated by ';' and their hosts by ',', each host given as
+     * addr[:port] or [addr]:port, optionally preceded by user:password@.
+     * For example "10.0.0.1:3000,10.0.0.2:3000;app:secret@10.0.1.1".
+     * The clusters are connected with the default policies, since no options
+     * are known yet, and keep them for every request reusing them.
+     * Clusters which are not reachable are skipped and get connected by the
+     * first request using them instead.
+     ************************************************************************************
+     */
+    static void prewarm_persistent_connections()
+    {
+        as_error            error;
+        as_config           config;
+        PolicyManager       policy_manager(&config);
+        int16_t             serializer_value = SERIALIZER_PHP;
+        uint64_t            cluster_id;
+        char                *clusters_p = NULL;
+        char                *cluster_p = NULL;
+        char                *save_p = NULL;
+
+        as_error_init(&error);
+
+        if (ini_entry.prewarm_clusters.empty()) {
+            return;
+        }
+
+        /*
+         * The as_config of each cluster keeps pointing into this buffer, so
+         * it is only released on process exit.
+         */
+        clusters_p = strdup(ini_entry.prewarm_clusters.c_str());
+        if (!clusters_p) {
+            return;
+        }
 
-                iterate_hosts_add_entry(config, 0);
+        for (cluster_p = strtok_r(clusters_p, ";", &save_p); cluster_p;
+                cluster_p = strtok_r(NULL, ";", &save_p)) {
+            if (AEROSPIKE_OK != ini_cluster_to_as_config(cluster_p, config, error) ||
+                    AEROSPIKE_OK != policy_manager.set_global_defaults(&serializer_value,
+                        init_null(), error)) {
+                continue;
+            }
+
+            cluster_id = get_cluster_id(config);
+            if (!persistent_list.find(cluster_id)) {
+                publish_new_host_entry(config, cluster_id, error);
+            }
+        }
+    }
+
+    /*
+     ************************************************************************************
+     * This function will connect the Aerospike object to the cluster
+     * described by the PHP config array, applying the options.
+     ************************************************************************************
+     */
+    as_status Aerospike::connect_to_cluster(const Array& php_config,
+            const Variant& options, as_error& error)
+    {
+        as_config           config;
+        PolicyManager       policy_manager(&config);
+
+        as_error_reset(&error);
+
+        if (AEROSPIKE_OK == php_config_to_as_config(php_config,
+                    config, error)) {
+            if (AEROSPIKE_OK == policy_manager.set_global_defaults(&serializer_value,
+                        options, error)) {
+                if (AEROSPIKE_OK == configure_connection(config, error)) {
+                    if (!is_connected && as_ref_p->as_p) {
+                        if (AEROSPIKE_OK == aerospike_connect(as_ref_p->as_p,
+                                    &error)) {
+                            is_connected = true;
+                        } else {
+                            as_error_update(&error, AEROSPIKE_ERR_CLUSTER,
+                                    "Unable to connect to server");
+                            as_ref_p->ref_php_object--;
+                        }
+                    }
+                }
             }
-        } else {
-            create_new_host_entry(config, error);
         }
 
         return error.code;
     }
 
+    /*
+     ************************************************************************************
+     * This function will make the connection deferred by OPT_CONNECT_LAZY, if
+     * it is still pending. Invoked by every operation before it uses the
+     * connection.
+     ************************************************************************************
+     */
+    as_status Aerospike::connect_deferred(as_error& error)
+    {
+        if (!is_connect_deferred) {
+            return AEROSPIKE_OK;
+        }
+
+        is_connect_deferred = false;
+        connect_to_cluster(deferred_config.toArray(), deferred_options, error);
+        deferred_config = init_null();
+        deferred_options = init_null();
+
+        return error.code;
+    }
+
     /*
      ************************************************************************************
      * Definitions of Native methods in PHP Aerospike class declared in
@@ -255,31 +461,27 @@ namespace HPHP {
         data->is_persistent = persistent_connection;
         data->serializer_value = SERIALIZER_PHP;
 
-        if (data->as_ref_p) {
+        if (data->as_ref_p || data->is_connect_deferred) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Connection already exists!");
-        } else if (AEROSPIKE_OK == php_config_to_as_config(php_config,
-                    config, error)) {
-            if (AEROSPIKE_OK == policy_manager.set_global_defaults(&data->serializer_value,
+        } else if (options.isArray() && options.toArray().exists(OPT_CONNECT_LAZY) &&
+                options.toArray()[OPT_CONNECT_LAZY].toBoolean()) {
+            /*
+             * Validate the config and options right away, but defer the
+             * connection until the first operation needs it.
+             */
+            if (AEROSPIKE_OK == php_config_to_as_config(php_config, config, error) &&
+                    AEROSPIKE_OK == policy_manager.set_global_defaults(&data->serializer_value,
                         options, error)) {
-                if (AEROSPIKE_OK == data->configure_connection(config, error)) {
-                    if (data->as_ref_p->ref_php_object <= 1 && data->as_ref_p->as_p) {
-                        if (AEROSPIKE_OK == aerospike_connect(data->as_ref_p->as_p,
-                                    &error)) {
-                            data->is_connected = true;
-                        } else {
-                            as_error_update(&error, AEROSPIKE_ERR_CLUSTER,
-                                    "Unable to connect to server");
-                            data->as_ref_p->ref_php_object--;
-                        }
-                    }
-                }
+                data->deferred_config = php_config;
+                data->deferred_options = options;
+                data->is_connect_deferred = true;
             }
+        } else {
+            data->connect_to_cluster(php_config, options, error);
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
     }
     /* }}} */
 
@@ -287,7 +489,20 @@ namespace HPHP {
        Tests whether the connection to the cluster was established */
     bool HHVM_METHOD(Aerospike, isConnected)
     {
+        VMRegAnchor         _;
         auto                data = Native::data<Aerospike>(this_);
+        as_error            error;
+
+        as_error_init(&error);
+
+        if (data->is_connect_deferred) {
+            /*
+             * A deferred connection is only known to be established once
+             * it is attempted.
+             */
+            data->connect_deferred(error);
+            data->set_latest_error(error);
+        }
 
         if (!data->as_ref_p || !data->as_ref_p->as_p) {
             // Invalid aerospike connection object
@@ -308,7 +523,13 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (data->is_connect_deferred) {
+            /*
+             * Nothing got connected yet, just stop deferring the connection.
+             * The config is kept for reconnect().
+             */
+            data->is_connect_deferred = false;
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected ||
@@ -325,16 +546,12 @@ namespace HPHP {
                  * references for internal CSDK aerospike object being held by
                  * the various PHP userland functions.
                  */
-                pthread_rwlock_wrlock(&connection_mutex);
                 data->as_ref_p->ref_php_object--;
-                pthread_rwlock_unlock(&connection_mutex);
             }
             data->is_connected = false;
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -349,7 +566,13 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (!data->as_ref_p && !data->deferred_config.isNull()) {
+            /*
+             * Closed before the deferred connection was made, connect now.
+             */
+            data->is_connect_deferred = true;
+            data->connect_deferred(error);
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (data->is_connected ||
@@ -374,9 +597,7 @@ namespace HPHP {
                      * references for internal CSDK aerospike object being held by
                      * the various PHP userland functions.
                      */
-                    pthread_rwlock_wrlock(&connection_mutex);
                     data->as_ref_p->ref_php_object++;
-                    pthread_rwlock_unlock(&connection_mutex);
                     data->is_connected = true;
                 } else {
                     as_error_update(&error, AEROSPIKE_ERR_CLIENT,
@@ -385,9 +606,7 @@ namespace HPHP {
             }
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -419,6 +638,25 @@ namespace HPHP {
 
         Aerospike::deserializer = callback;
         Aerospike::is_deserializer_registered = 1;
+        Aerospike::is_deserializer_batched = 0;
+
+        return true;
+    }
+    /* }}} */
+
+    /* {{{ proto static Aerospike::setBatchDeserializer( callback unserialize_cb )
+       Sets a userland method as responsible for deserializing all the bin
+       values of a record or of a batch read at once */
+    bool HHVM_STATIC_METHOD(Aerospike, setBatchDeserializer, const Variant& callback)
+    {
+        if (!callback.isObject()) {
+            //Invalid callback function
+            return false;
+        }
+
+        Aerospike::deserializer = callback;
+        Aerospike::is_deserializer_registered = 1;
+        Aerospike::is_deserializer_batched = 1;
 
         return true;
     }
@@ -435,7 +673,8 @@ namespace HPHP {
         as_error            error;
         as_key              key;
         as_record           rec;
-        StaticPoolManager   static_pool;
+        StaticPoolScope     static_pool_scope;
+        StaticPoolManager&  static_pool = static_pool_scope.get();
         as_policy_write     write_policy;
         bool                key_initialized = false;
         int16_t             serializer_option = 0;
@@ -443,7 +682,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -469,9 +710,7 @@ namespace HPHP {
         if (key_initialized) {
             as_key_destroy(&key);
         }
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -493,7 +732,9 @@ namespace HPHP {
        
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -512,9 +753,7 @@ namespace HPHP {
             }
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -531,7 +770,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -545,9 +786,7 @@ namespace HPHP {
                         &error, &info_policy,ns.toString().c_str(), name.toString().c_str());
         }
         
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -566,8 +805,11 @@ namespace HPHP {
         as_policy_read      read_policy;
         bool                key_initialized = false;
         PolicyManager       policy_manager;
+        Array               boolean_bins = Array::Create();
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -578,7 +820,8 @@ namespace HPHP {
             if (AEROSPIKE_OK == policy_manager.initPolicyManager(&read_policy,
                         "read", &data->as_ref_p->as_p->config, error) &&
                     AEROSPIKE_OK == policy_manager.set_policy(NULL,
-                        data->serializer_value, options, error)) {
+                        data->serializer_value, options, error) &&
+                    AEROSPIKE_OK == get_boolean_bins_hint(options, boolean_bins, error)) {
                 if (!filter_bins.isNull() && !filter_bins.isArray()) {
                     as_error_update(&error, AEROSPIKE_ERR_PARAM,
                             "Filter bins must be of type an Array");
@@ -591,11 +834,24 @@ namespace HPHP {
                         status = aerospike_key_get(data->as_ref_p->as_p, &error,
                                 &read_policy, &key, &rec_p);
                     }
-                    Array temp_php_rec = Array::Create();
-                    if (status == AEROSPIKE_OK) {
-                        as_record_to_php_record(rec_p, &key, temp_php_rec, &read_policy.key, error);
+                    CollectionsScope collections_scope(is_collections_requested(options));
+                    DecodeJsonScope decode_json_scope(is_decode_json_requested(options));
+                    if (status == AEROSPIKE_OK && is_lazy_record_requested(options)) {
+                        Variant temp_php_rec;
+                        as_record_to_lazy_record(rec_p, &key, temp_php_rec,
+                                &read_policy.key, true, error);
+                        rec_p = NULL;
+                        apply_boolean_bins_hint_to_lazy_record(boolean_bins, temp_php_rec);
+                        php_rec.assignIfRef(temp_php_rec);
+                    } else {
+                        Array temp_php_rec = Array::Create();
+                        if (status == AEROSPIKE_OK &&
+                                AEROSPIKE_OK == as_record_to_php_record(rec_p, &key,
+                                    temp_php_rec, &read_policy.key, error)) {
+                            apply_boolean_bins_hint(boolean_bins, temp_php_rec);
+                        }
+                        php_rec.assignIfRef(temp_php_rec);
                     }
-                    php_rec.assignIfRef(temp_php_rec);
                     as_record_destroy(rec_p);
                 }
             }
@@ -604,9 +860,7 @@ namespace HPHP {
         if (key_initialized) {
             as_key_destroy(&key);
         }
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -627,7 +881,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -636,13 +892,20 @@ namespace HPHP {
         } else {
             try {
                 BatchOpManager batch_op_manager(php_keys);
+                Array   boolean_bins = Array::Create();
                 if (AEROSPIKE_OK == policy_manager.initPolicyManager(&batch_policy,
                             "batch", &data->as_ref_p->as_p->config, error) &&
                         AEROSPIKE_OK == policy_manager.set_policy(NULL,
-                            data->serializer_value, options, error)) {
+                            data->serializer_value, options, error) &&
+                        AEROSPIKE_OK == get_boolean_bins_hint(options, boolean_bins, error)) {
+                    CollectionsScope collections_scope(is_collections_requested(options));
+                    DecodeJsonScope decode_json_scope(is_decode_json_requested(options));
                     Array   temp_php_records = Array::Create();
                     batch_op_manager.execute_batch_get(data->as_ref_p->as_p,
-                            temp_php_records, filter_bins, batch_policy, error);
+                            temp_php_records, filter_bins, batch_policy, error,
+                            is_lazy_record_requested(options),
+                            is_positional_results_requested(options));
+                    apply_boolean_bins_hint_to_records(boolean_bins, temp_php_records);
                     php_records.assignIfRef(temp_php_records);
                 }
             } catch (const std::exception& e) {
@@ -651,9 +914,7 @@ namespace HPHP {
             }
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -673,7 +934,9 @@ namespace HPHP {
         Array empty_array = Array::Create();
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -682,12 +945,19 @@ namespace HPHP {
         } else {
             try {
                 BatchOpManager batch_op_manager(php_keys);
+                Array   boolean_bins = Array::Create();
                 if (AEROSPIKE_OK == policy_manager.initPolicyManager(&batch_policy,
                             "batch", &data->as_ref_p->as_p->config, error) &&
                         AEROSPIKE_OK == policy_manager.set_policy(NULL,
-                            data->serializer_value, options, error)) {
+                            data->serializer_value, options, error) &&
+                        AEROSPIKE_OK == get_boolean_bins_hint(options, boolean_bins, error)) {
+                    CollectionsScope collections_scope(is_collections_requested(options));
+                    DecodeJsonScope decode_json_scope(is_decode_json_requested(options));
                     batch_op_manager.execute_batch_get(data->as_ref_p->as_p,
-                            empty_array, filter_bins, batch_policy, error);
+                            empty_array, filter_bins, batch_policy, error,
+                            is_lazy_record_requested(options),
+                            is_positional_results_requested(options));
+                    apply_boolean_bins_hint_to_records(boolean_bins, empty_array);
                     return empty_array;
                 }
             } catch (const std::exception& e) {
@@ -696,14 +966,114 @@ namespace HPHP {
             }
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
 
         return empty_array;
     }
     /* }}} */
 
+    /* {{{ proto int Aerospike::getManyStream( array keys, callback function [, array filter [, array options ]] )
+       Passes a batch of records from the cluster to a callback */
+    int64_t HHVM_METHOD(Aerospike, getManyStream, const Array& php_keys,
+            const Variant& function, const Variant& filter_bins,
+            const Variant& options)
+    {
+        VMRegAnchor         _;
+        auto                data = Native::data<Aerospike>(this_);
+        as_error            error;
+        as_policy_batch     batch_policy;
+        int64_t             chunk_size = 0;
+        PolicyManager       policy_manager;
+
+        as_error_init(&error);
+
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
+            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Invalid aerospike connection object");
+        } else if (!data->is_connected) {
+            as_error_update(&error, AEROSPIKE_ERR_CLUSTER,
+                    "getManyStream: connection not established");
+        } else if (!function.isObject()) {
+            as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                    "Parameter 2 must be a function object");
+        } else {
+            try {
+                BatchOpManager batch_op_manager(php_keys);
+                Array   boolean_bins = Array::Create();
+                if (AEROSPIKE_OK == policy_manager.initPolicyManager(&batch_policy,
+                            "batch", &data->as_ref_p->as_p->config, error) &&
+                        AEROSPIKE_OK == policy_manager.set_policy(NULL,
+                            data->serializer_value, options, error) &&
+                        AEROSPIKE_OK == get_boolean_bins_hint(options, boolean_bins, error) &&
+                        AEROSPIKE_OK == get_stream_chunk_size(options, chunk_size, error)) {
+                    CollectionsScope collections_scope(is_collections_requested(options));
+                    DecodeJsonScope decode_json_scope(is_decode_json_requested(options));
+                    batch_op_manager.execute_batch_get_stream(data->as_ref_p->as_p,
+                            function, chunk_size, filter_bins, boolean_bins,
+                            batch_policy, error, is_lazy_record_requested(options));
+                }
+            } catch (const std::exception& e) {
+                as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                        "Failed to initialize batch operation");
+            }
+        }
+
+        data->set_latest_error(error);
+        return error.code;
+    }
+    /* }}} */
+
+    /* {{{ proto int Aerospike::batchRead( array entries, array &records [, array options ] )
+       Returns a batch of records from the cluster, with the bins selected per key */
+    int64_t HHVM_METHOD(Aerospike, batchRead, const Array& php_entries,
+            VRefParam php_records, const Variant& options)
+    {
+        VMRegAnchor         _;
+        auto                data = Native::data<Aerospike>(this_);
+        as_error            error;
+        as_policy_batch     batch_policy;
+        PolicyManager       policy_manager;
+
+        as_error_init(&error);
+
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
+            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Invalid aerospike connection object");
+        } else if (!data->is_connected) {
+            as_error_update(&error, AEROSPIKE_ERR_CLUSTER,
+                    "batchRead: connection not established");
+        } else {
+            try {
+                BatchReadManager batch_read_manager(php_entries);
+                Array   boolean_bins = Array::Create();
+                if (AEROSPIKE_OK == policy_manager.initPolicyManager(&batch_policy,
+                            "batch", &data->as_ref_p->as_p->config, error) &&
+                        AEROSPIKE_OK == policy_manager.set_policy(NULL,
+                            data->serializer_value, options, error) &&
+                        AEROSPIKE_OK == get_boolean_bins_hint(options, boolean_bins, error)) {
+                    CollectionsScope collections_scope(is_collections_requested(options));
+                    DecodeJsonScope decode_json_scope(is_decode_json_requested(options));
+                    Array   temp_php_records = Array::Create();
+                    batch_read_manager.execute_batch_read(data->as_ref_p->as_p,
+                            temp_php_records, boolean_bins, batch_policy, error,
+                            is_lazy_record_requested(options));
+                    php_records.assignIfRef(temp_php_records);
+                }
+            } catch (const std::exception& e) {
+                as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                        "Invalid batch read entries");
+            }
+        }
+
+        data->set_latest_error(error);
+        return error.code;
+    }
+    /* }}} */
+
     /* {{{ proto int Aerospike::operate ( array key, array operations [, array &returned [, array options ]] )
        Performs multiple operations on a record */
     int64_t HHVM_METHOD(Aerospike, operate, const Array& php_key,
@@ -714,7 +1084,8 @@ namespace HPHP {
         auto                data = Native::data<Aerospike>(this_);
         as_error            error;
         as_key              key;
-        StaticPoolManager   static_pool;
+        StaticPoolScope     static_pool_scope;
+        StaticPoolManager&  static_pool = static_pool_scope.get();
         as_operations       operations;
         as_record           *rec_p = NULL;
         as_policy_operate   operate_policy;
@@ -724,7 +1095,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -743,6 +1116,8 @@ namespace HPHP {
                                     options, error))) {
                         aerospike_key_operate(data->as_ref_p->as_p, &error,
                                 &operate_policy, &key, &operations, &rec_p);
+                        CollectionsScope collections_scope(is_collections_requested(options));
+                        DecodeJsonScope decode_json_scope(is_decode_json_requested(options));
                         Array php_rec = Array::Create();
                         if (rec_p) {
                             bins_to_php_bins(rec_p, php_rec, error);
@@ -757,9 +1132,7 @@ namespace HPHP {
         if (key_initialized) {
             as_key_destroy(&key);
         }
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -779,7 +1152,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -801,9 +1176,7 @@ namespace HPHP {
         if (key_initialized) {
             as_key_destroy(&key);
         }
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -824,7 +1197,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -854,9 +1229,7 @@ namespace HPHP {
         if (key_initialized) {
             as_key_destroy(&key);
         }
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -877,7 +1250,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -902,9 +1277,7 @@ namespace HPHP {
         if (key_initialized) {
             as_key_destroy(&key);
         }
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -922,7 +1295,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -937,7 +1312,8 @@ namespace HPHP {
                             data->serializer_value, options, error)) {
                     Array   php_metadata = Array::Create();
                     batch_op_manager.execute_batch_exists(data->as_ref_p->as_p,
-                            php_metadata, batch_policy, error);
+                            php_metadata, batch_policy, error,
+                            is_positional_results_requested(options));
                     metadata.assignIfRef(php_metadata);
                 }
             } catch (const std::exception& e) {
@@ -946,9 +1322,174 @@ namespace HPHP {
             }
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
+        return error.code;
+    }
+    /* }}} */
+
+    /* {{{ proto int Aerospike::putMany( array keys, array records [, array &statuses [, int ttl=0 [, array options ]]] )
+       Writes a batch of records to the cluster concurrently */
+    int64_t HHVM_METHOD(Aerospike, putMany, const Array& php_keys,
+            const Array& php_records, VRefParam statuses, int64_t ttl,
+            const Variant& options)
+    {
+        VMRegAnchor         _;
+        auto                data = Native::data<Aerospike>(this_);
+        as_error            error;
+        StaticPoolScope     static_pool_scope;
+        StaticPoolManager&  static_pool = static_pool_scope.get();
+        as_policy_write     write_policy;
+        int16_t             serializer_option = 0;
+        uint16_t            gen = 0;
+        PolicyManager       policy_manager;
+
+        as_error_init(&error);
+
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
+            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Invalid aerospike connection object");
+        } else if (!data->is_connected) {
+            as_error_update(&error, AEROSPIKE_ERR_CLUSTER,
+                    "putMany: connection not established");
+        } else {
+            try {
+                BatchWriteManager batch_write_manager(php_keys);
+                if (AEROSPIKE_OK == policy_manager.initPolicyManager(&write_policy,
+                            "write", &data->as_ref_p->as_p->config, error) &&
+                        AEROSPIKE_OK == policy_manager.set_policy(&serializer_option,
+                            data->serializer_value, options, error) &&
+                        AEROSPIKE_OK == policy_manager.set_generation_value(&gen,
+                            options, error)) {
+                    Array   php_statuses = Array::Create();
+                    batch_write_manager.execute_put_many(data->as_ref_p->as_p,
+                            php_records, ttl, gen, write_policy, static_pool,
+                            serializer_option, php_statuses, error);
+                    statuses.assignIfRef(php_statuses);
+                }
+            } catch (const std::exception& e) {
+                as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                        "Failed to initialize batch operation");
+            }
+        }
+
+        data->set_latest_error(error);
+        return error.code;
+    }
+    /* }}} */
+
+    /* {{{ proto int Aerospike::removeMany( array keys [, array &statuses [, array options ]] )
+       Removes a batch of records from the cluster concurrently */
+    int64_t HHVM_METHOD(Aerospike, removeMany, const Array& php_keys,
+            VRefParam statuses, const Variant& options)
+    {
+        VMRegAnchor         _;
+        auto                data = Native::data<Aerospike>(this_);
+        as_error            error;
+        as_policy_remove    remove_policy;
+        PolicyManager       policy_manager;
+
+        as_error_init(&error);
+
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
+            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Invalid aerospike connection object");
+        } else if (!data->is_connected) {
+            as_error_update(&error, AEROSPIKE_ERR_CLUSTER,
+                    "removeMany: connection not established");
+        } else {
+            try {
+                BatchWriteManager batch_write_manager(php_keys);
+                if (AEROSPIKE_OK == policy_manager.initPolicyManager(&remove_policy,
+                            "remove", &data->as_ref_p->as_p->config, error) &&
+                        AEROSPIKE_OK == policy_manager.set_policy(NULL,
+                            data->serializer_value, options, error) &&
+                        AEROSPIKE_OK == policy_manager.set_generation_value(
+                            &remove_policy.generation, options, error)) {
+                    Array   php_statuses = Array::Create();
+                    batch_write_manager.execute_remove_many(data->as_ref_p->as_p,
+                            remove_policy, php_statuses, error);
+                    statuses.assignIfRef(php_statuses);
+                }
+            } catch (const std::exception& e) {
+                as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                        "Failed to initialize batch operation");
+            }
+        }
+
+        data->set_latest_error(error);
+        return error.code;
+    }
+    /* }}} */
+
+    /* {{{ proto int Aerospike::operateMany( array keys, array operations [, array &statuses [, array &returned [, array options ]]] )
+       Applies the same operations to a batch of records concurrently */
+    int64_t HHVM_METHOD(Aerospike, operateMany, const Array& php_keys,
+            const Array& php_operations, VRefParam statuses, VRefParam returned,
+            const Variant& options)
+    {
+        VMRegAnchor         _;
+        auto                data = Native::data<Aerospike>(this_);
+        as_error            error;
+        StaticPoolScope     static_pool_scope;
+        StaticPoolManager&  static_pool = static_pool_scope.get();
+        as_operations       operations;
+        as_policy_operate   operate_policy;
+        int16_t             serializer_option = 0;
+        bool                operations_initialized = false;
+        PolicyManager       policy_manager;
+
+        as_error_init(&error);
+
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
+            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Invalid aerospike connection object");
+        } else if (!data->is_connected) {
+            as_error_update(&error, AEROSPIKE_ERR_CLUSTER,
+                    "operateMany: connection not established");
+        } else {
+            try {
+                BatchWriteManager batch_write_manager(php_keys);
+                if (AEROSPIKE_OK == policy_manager.initPolicyManager(&operate_policy,
+                            "operate", &data->as_ref_p->as_p->config, error) &&
+                        AEROSPIKE_OK == policy_manager.set_policy(&serializer_option,
+                            data->serializer_value, options, error)) {
+                    /*
+                     * The operations are initialised even when the conversion
+                     * fails, so they must be destroyed in either case.
+                     */
+                    operations_initialized = true;
+                    if (AEROSPIKE_OK == php_operations_to_as_operations(php_operations,
+                                operations, static_pool, serializer_option, error) &&
+                            AEROSPIKE_OK == policy_manager.set_generation_value(&operations.gen,
+                                options, error) && AEROSPIKE_OK == policy_manager.set_ttl_value(
+                                &operations.ttl, options, error)) {
+                        CollectionsScope collections_scope(is_collections_requested(options));
+                        DecodeJsonScope decode_json_scope(is_decode_json_requested(options));
+                        Array   php_statuses = Array::Create();
+                        Array   php_returned = Array::Create();
+                        batch_write_manager.execute_operate_many(data->as_ref_p->as_p,
+                                operations, operate_policy, php_statuses, php_returned,
+                                error);
+                        statuses.assignIfRef(php_statuses);
+                        returned.assignIfRef(php_returned);
+                    }
+                }
+            } catch (const std::exception& e) {
+                as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                        "Failed to initialize batch operation");
+            }
+        }
+
+        if (operations_initialized) {
+            as_operations_destroy(&operations);
+        }
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -987,7 +1528,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -1002,9 +1545,7 @@ namespace HPHP {
             }
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -1021,7 +1562,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -1036,9 +1579,7 @@ namespace HPHP {
             }
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -1057,7 +1598,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -1074,9 +1617,7 @@ namespace HPHP {
             }
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
     /* }}} */
@@ -1093,7 +1634,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -1112,9 +1655,7 @@ namespace HPHP {
             }
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
         return error.code;
     }
 
@@ -1129,14 +1670,17 @@ namespace HPHP {
         as_key              key;
         as_policy_apply     apply_policy;
         int16_t             serializer_type = SERIALIZER_PHP;
-        StaticPoolManager   static_pool;
+        StaticPoolScope     static_pool_scope;
+        StaticPoolManager&  static_pool = static_pool_scope.get();
         bool                key_initialized = false;
         PolicyManager       policy_manager;
         Variant             temp_returned_value;
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -1158,9 +1702,7 @@ namespace HPHP {
             as_key_destroy(&key);
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
 
         return error.code;
     }
@@ -1183,7 +1725,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -1199,6 +1743,9 @@ namespace HPHP {
                     AEROSPIKE_OK == policy_manager.set_policy(NULL,
                         data->serializer_value, options, error) &&
                     AEROSPIKE_OK == set_scan_policies(&scan, options, error)) {
+                udata.is_lazy_record = is_lazy_record_requested(options);
+                udata.is_collections = is_collections_requested(options);
+                udata.is_decode_json = is_decode_json_requested(options);
                 aerospike_scan_foreach(data->as_ref_p->as_p, &error,
                         &scan_policy, &scan, scan_query_callback, &udata);
             }
@@ -1208,9 +1755,7 @@ namespace HPHP {
             as_scan_destroy(&scan);
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
 
         return error.code;
     }
@@ -1226,7 +1771,8 @@ namespace HPHP {
         as_error            error;
         as_scan             scan;
         uint64_t            _scan_id = 0;
-        StaticPoolManager   static_pool;
+        StaticPoolScope     static_pool_scope;
+        StaticPoolManager&  static_pool = static_pool_scope.get();
         as_policy_scan      scan_policy;
         as_policy_info      info_policy;
         bool                scan_initialized = false;
@@ -1237,7 +1783,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -1273,9 +1821,7 @@ namespace HPHP {
             as_scan_destroy(&scan);
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
 
         return error.code;
     }
@@ -1295,7 +1841,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -1321,9 +1869,7 @@ namespace HPHP {
             }
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
 
         return error.code;
     }
@@ -1425,7 +1971,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -1440,6 +1988,9 @@ namespace HPHP {
                         "query", &data->as_ref_p->as_p->config, error) &&
                     AEROSPIKE_OK == policy_manager.set_policy(NULL,
                         data->serializer_value, options, error)) {
+                udata.is_lazy_record = is_lazy_record_requested(options);
+                udata.is_collections = is_collections_requested(options);
+                udata.is_decode_json = is_decode_json_requested(options);
                 aerospike_query_foreach(data->as_ref_p->as_p, &error,
                         &query_policy, &query, scan_query_callback, &udata);
             }
@@ -1449,9 +2000,7 @@ namespace HPHP {
             as_query_destroy(&query);
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
 
         return error.code;
     }
@@ -1468,7 +2017,8 @@ namespace HPHP {
         as_query            query;
         as_policy_query     query_policy;
         bool                query_initialized = false;
-        StaticPoolManager   static_pool;
+        StaticPoolScope     static_pool_scope;
+        StaticPoolManager&  static_pool = static_pool_scope.get();
         int16_t             serializer_type = SERIALIZER_PHP;
         Array               aggregate_array = Array::Create();
         Variant             result_variant;
@@ -1478,7 +2028,9 @@ namespace HPHP {
 
         as_error_init(&error);
 
-        if (!data->as_ref_p || !data->as_ref_p->as_p) {
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
             as_error_update(&error, AEROSPIKE_ERR_CLIENT,
                     "Invalid aerospike connection object");
         } else if (!data->is_connected) {
@@ -1502,9 +2054,7 @@ namespace HPHP {
             as_query_destroy(&query);
         }
 
-        pthread_rwlock_wrlock(&data->latest_error_mutex);
-        as_error_copy(&data->latest_error, &error);
-        pthread_rwlock_unlock(&data->latest_error_mutex);
+        data->set_latest_error(error);
 
         result_variant = aggregate_array;
         result_variant.releaseForSweep();
@@ -1518,7 +2068,7 @@ namespace HPHP {
     int64_t HHVM_METHOD(Aerospike, errorno)
     {
         auto                data = Native::data<Aerospike>(this_);
-        return data->latest_error.code;
+        return data->latest_error_code;
     }
     /* }}} */
 
@@ -1527,7 +2077,51 @@ namespace HPHP {
     String HHVM_METHOD(Aerospike, error)
     {
         auto                data = Native::data<Aerospike>(this_);
-        return data->latest_error.message;
+        if (data->latest_error_code == AEROSPIKE_OK) {
+            return empty_string();
+        }
+        return String(data->latest_error.message, CopyString);
+    }
+    /* }}} */
+
+    /* {{{ proto int Aerospike::getInstanceStats( array &stats )
+       Gets the usage of the C client instances kept for the cluster */
+    int64_t HHVM_METHOD(Aerospike, getInstanceStats, VRefParam stats)
+    {
+        VMRegAnchor         _;
+        auto                data = Native::data<Aerospike>(this_);
+        as_error            error;
+        aerospike_ref       *primary_p = NULL;
+        aerospike_ref       *instance_p = NULL;
+        size_t              instances_size;
+
+        as_error_init(&error);
+
+        if (AEROSPIKE_OK != data->connect_deferred(error)) {
+            // Deferred connection failed, error is already populated
+        } else if (!data->as_ref_p || !data->as_ref_p->as_p) {
+            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Invalid aerospike connection object");
+        } else {
+            Array php_stats = Array::Create();
+
+            primary_p = data->as_ref_p->primary_p;
+            instances_size = primary_p->instances.empty() ? 1 : primary_p->instances.size();
+            for (size_t iter = 0; iter < instances_size; iter++) {
+                instance_p = primary_p->instances.empty() ? primary_p : primary_p->instances[iter];
+
+                Array php_instance = Array::Create();
+                php_instance.set(s_instance, (int64_t) iter);
+                php_instance.set(s_php_objects, (int64_t) instance_p->ref_php_object.load());
+                php_instance.set(s_bound, (int64_t) instance_p->bind_count.load());
+                php_instance.set(s_current, instance_p == data->as_ref_p);
+                php_stats.append(php_instance);
+            }
+            stats.assignIfRef(php_stats);
+        }
+
+        data->set_latest_error(error);
+        return error.code;
     }
     /* }}} */
 
@@ -1538,6 +2132,23 @@ namespace HPHP {
      ************************************************************************************
      */
 
+    /*
+     ************************************************************************************
+     * Function invoked on module shutdown for each cluster within the
+     * persistent_list. Closes and destroys the C client's aerospike object once
+     * the last entry referring to it is released.
+     ************************************************************************************
+     */
+    static void release_persistent_entry(aerospike_ref *map_entry)
+    {
+        if (map_entry->ref_host_entry > 1) {
+            map_entry->ref_host_entry--;
+        } else {
+            map_entry->ref_host_entry = 0;
+            destroy_host_entry(map_entry);
+        }
+    }
+
     class AerospikeExtension : public Extension {
         public:
             AerospikeExtension(): Extension("aerospike", "1.0") {}
@@ -1556,6 +2167,8 @@ namespace HPHP {
                 HHVM_ME(Aerospike, get);
                 HHVM_ME(Aerospike, getMany);
                 HHVM_ME(Aerospike, getManyDirect);
+                HHVM_ME(Aerospike, getManyStream);
+                HHVM_ME(Aerospike, batchRead);
                 HHVM_ME(Aerospike, addIndex);
                 HHVM_ME(Aerospike, dropIndex);
                 HHVM_ME(Aerospike, operate);
@@ -1563,6 +2176,9 @@ namespace HPHP {
                 HHVM_ME(Aerospike, removeBin);
                 HHVM_ME(Aerospike, exists);
                 HHVM_ME(Aerospike, existsMany);
+                HHVM_ME(Aerospike, putMany);
+                HHVM_ME(Aerospike, removeMany);
+                HHVM_ME(Aerospike, operateMany);
                 HHVM_ME(Aerospike, getKeyDigest);
                 HHVM_ME(Aerospike, register);
                 HHVM_ME(Aerospike, deregister);
@@ -1580,10 +2196,12 @@ namespace HPHP {
                 HHVM_ME(Aerospike, aggregate);
                 HHVM_ME(Aerospike, errorno);
                 HHVM_ME(Aerospike, error);
+                HHVM_ME(Aerospike, getInstanceStats);
                 HHVM_STATIC_ME(Aerospike, setSerializer);
                 HHVM_STATIC_ME(Aerospike, setDeserializer);
+                HHVM_STATIC_ME(Aerospike, setBatchDeserializer);
                 Native::registerNativeDataInfo<Aerospike>(s_Aerospike.get());
-                pthread_rwlock_init(&connection_mutex, NULL);
+                register_lazy_record_class();
                 pthread_rwlock_init(&scan_query_callback_mutex, NULL);
 
                 loadSystemlib();
@@ -1608,7 +2226,7 @@ namespace HPHP {
                         "1", &ini_entry.serializer_type);
                 IniSetting::Bind(this, IniSetting::PHP_INI_ALL,
                         "aerospike.nesting_depth",
-                        "3", &ini_entry.nesting_depth);
+                        "32", &ini_entry.nesting_depth);
                 IniSetting::Bind(this, IniSetting::PHP_INI_ALL,
                         "aerospike.log_path",
                         NULL, &ini_entry.log_path);
@@ -1639,44 +2257,50 @@ namespace HPHP {
                         "aerospike.shm.shm_key",
                         "0xA5000000",
                         &ini_entry.shm_key);
+                IniSetting::Bind(this, IniSetting::PHP_INI_SYSTEM,
+                        "aerospike.connection.instances",
+                        "1",
+                        &ini_entry.connection_instances);
+                IniSetting::Bind(this, IniSetting::PHP_INI_SYSTEM,
+                        "aerospike.prewarm.clusters",
+                        "",
+                        &ini_entry.prewarm_clusters);
+                IniSetting::Bind(this, IniSetting::PHP_INI_ALL,
+                        "aerospike.zero_copy_writes",
+                        "true", &ini_entry.zero_copy_writes);
+                IniSetting::Bind(this, IniSetting::PHP_INI_ALL,
+                        "aerospike.native_doubles",
+                        "false", &ini_entry.native_doubles);
+                IniSetting::Bind(this, IniSetting::PHP_INI_ALL,
+                        "aerospike.native_booleans",
+                        "false", &ini_entry.native_booleans);
+                IniSetting::Bind(this, IniSetting::PHP_INI_ALL,
+                        "aerospike.compression_threshold",
+                        "0", &ini_entry.compression_threshold);
+                IniSetting::Bind(this, IniSetting::PHP_INI_ALL,
+                        "aerospike.batch_concurrency",
+                        "16", &ini_entry.batch_concurrency);
+                IniSetting::Bind(this, IniSetting::PHP_INI_ALL,
+                        "aerospike.batch_max_keys",
+                        "5000", &ini_entry.batch_max_keys);
+                IniSetting::Bind(this, IniSetting::PHP_INI_SYSTEM,
+                        "aerospike.worker_threads",
+                        "32", &ini_entry.worker_threads);
+
+                /*
+                 * Only the first request thread connects the declared
+                 * clusters, the others wait for it and then find them in the
+                 * persistent list.
+                 */
+                std::call_once(prewarm_once_flag, prewarm_persistent_connections);
             }
 
             void moduleShutdown() override
             {
-                as_error error;
-                aerospike_ref *map_entry = NULL;
                 Aerospike::serializer.releaseForSweep();
                 Aerospike::deserializer.releaseForSweep();
 
-                as_error_init(&error);
-
-                pthread_rwlock_wrlock(&connection_mutex);
-                auto it = persistent_list.begin();
-                while (it != persistent_list.end()) {
-                    map_entry = it->second;
-
-                    if (map_entry) {
-                        if (map_entry->ref_host_entry > 1) {
-                            map_entry->ref_host_entry--;
-                        } else {
-                            if (map_entry->as_p) {
-                                aerospike_close(map_entry->as_p, &error);
-                                aerospike_destroy(map_entry->as_p);
-                            }
-                            map_entry->ref_host_entry = 0;
-                            map_entry->as_p = NULL;
-                            if (map_entry) {
-                                free(map_entry);
-                            }
-                            map_entry = NULL;
-                        }
-                    } else {
-                        //Invalid aerospike object
-                    }
-                    ++it;
-                }
-                persistent_list.erase(persistent_list.begin(), persistent_list.end());
-                pthread_rwlock_wrlock(&connection_mutex);
+                persistent_list.clear(release_persistent_entry);
             }
             //free_shm_key();
     } s_aerospike_extension;
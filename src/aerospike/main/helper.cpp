@@ -1,5 +1,15 @@
 #include "helper.h"
 #include "conversions.h"
+#include "policy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
 
 namespace HPHP {
     /*
@@ -108,7 +118,8 @@ namespace HPHP {
      *                          selected by the get/getMany operation.
      * @param filter            The array of char*[] to be populated by this
      *                          function using the bin names (strings) within
-     *                          the php_filter_bins.
+     *                          the php_filter_bins, followed by a NULL. It
+     *                          must hold one more entry than php_filter_bins.
      * @param error             The as_error reference to be populated by this
      *                          function in case of error.
      *
@@ -118,7 +129,7 @@ namespace HPHP {
     as_status process_filter_bins(const Array& php_filter_bins,
             const char **filter, as_error& error)
     {
-        uint16_t            filter_count = 0;
+        uint32_t            filter_count = 0;
 
         as_error_reset(&error);
         for (ArrayIter iter(php_filter_bins); iter; ++iter) {
@@ -159,8 +170,8 @@ namespace HPHP {
             aerospike *as_p, as_policy_read *read_policy_p,
             as_key& key, as_record **record_pp, as_error& error)
     {
-        uint16_t            total_filter_count = php_filter_bins.size();
-        const char          *filter[total_filter_count];
+        uint32_t            total_filter_count = php_filter_bins.size();
+        const char          *filter[total_filter_count + 1];
 
         as_error_reset(&error);
 
@@ -171,4 +182,154 @@ namespace HPHP {
         return error.code;
     }
 
+
+    /*
+     **********************************************************************************************
+     * Process wide pool of worker threads running the jobs of
+     * run_concurrently() for all the requests, so that batch operations
+     * neither create threads per call nor run more than
+     * aerospike.worker_threads of them in total.
+     * The threads are started on first use and live as long as the process,
+     * so the pool is never destroyed.
+     **********************************************************************************************
+     */
+    class WorkerPool {
+        private:
+            std::mutex                          mutex;
+            std::condition_variable             task_available;
+            std::deque<std::function<void()>>   tasks;
+            uint32_t                            thread_count = 0;
+
+            void work();
+        public:
+            explicit WorkerPool(int64_t size);
+            bool submit(std::function<void()> task);
+            static WorkerPool& instance();
+    };
+
+    WorkerPool::WorkerPool(int64_t size)
+    {
+        for (int64_t iter = 0; iter < size; iter++) {
+            try {
+                std::thread(&WorkerPool::work, this).detach();
+                thread_count++;
+            } catch (const std::system_error& e) {
+                /*
+                 * Run the jobs on the threads which could be started.
+                 */
+                break;
+            }
+        }
+    }
+
+    void WorkerPool::work()
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                task_available.wait(lock, [this]() { return !tasks.empty(); });
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    bool WorkerPool::submit(std::function<void()> task)
+    {
+        if (0 == thread_count) {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        task_available.notify_one();
+        return true;
+    }
+
+    WorkerPool& WorkerPool::instance()
+    {
+        static WorkerPool *pool_p = new WorkerPool(ini_entry.worker_threads);
+        return *pool_p;
+    }
+
+    /*
+     **********************************************************************************************
+     * State shared by a call of run_concurrently() and the tasks it submits
+     * to the pool. A task which starts after the call closed the run does
+     * nothing, so the call never waits for tasks queued behind the jobs of
+     * other requests, and the state outlives such tasks.
+     **********************************************************************************************
+     */
+    struct concurrent_run {
+        std::mutex                              mutex;
+        std::condition_variable                 helpers_done;
+        bool                                    is_closed = false;
+        uint32_t                                active_helpers = 0;
+        std::atomic<uint32_t>                   next_index{0};
+        uint32_t                                count;
+        const std::function<void(uint32_t)>     *job_p;
+
+        void work() {
+            uint32_t index;
+            while ((index = next_index++) < count) {
+                (*job_p)(index);
+            }
+        }
+    };
+
+    /*
+     **********************************************************************************************
+     * Helper function to run a job for every index in 0..count-1 on the
+     * calling thread and up to concurrency-1 threads of the process wide
+     * WorkerPool. The threads take the next index until there is none left,
+     * so that slow jobs do not hold up the others, and busy pool threads
+     * never hold up the call: it runs the jobs itself, then waits only for
+     * the pool threads which took jobs of its own.
+     * The jobs run outside of the HHVM request, so they must only work on C
+     * client structures prepared beforehand, and never on HHVM values.
+     *
+     * @param count             The number of jobs to run
+     * @param concurrency       The maximum number of threads to run them on
+     * @param job               The job to run for each index
+     **********************************************************************************************
+     */
+    void run_concurrently(uint32_t count, int64_t concurrency,
+            const std::function<void(uint32_t)>& job)
+    {
+        auto run_p = std::make_shared<concurrent_run>();
+        run_p->count = count;
+        run_p->job_p = &job;
+
+        uint32_t helper_count = (concurrency <= 1 || count <= 1) ? 0 :
+            (uint32_t) std::min<int64_t>(concurrency, count) - 1;
+        for (uint32_t iter = 0; iter < helper_count; iter++) {
+            bool is_submitted = WorkerPool::instance().submit([run_p]() {
+                {
+                    std::lock_guard<std::mutex> lock(run_p->mutex);
+                    if (run_p->is_closed) {
+                        return;
+                    }
+                    run_p->active_helpers++;
+                }
+                run_p->work();
+                {
+                    std::lock_guard<std::mutex> lock(run_p->mutex);
+                    run_p->active_helpers--;
+                }
+                run_p->helpers_done.notify_all();
+            });
+            if (!is_submitted) {
+                break;
+            }
+        }
+
+        run_p->work();
+
+        std::unique_lock<std::mutex> lock(run_p->mutex);
+        run_p->is_closed = true;
+        run_p->helpers_done.wait(lock, [&run_p]() { return 0 == run_p->active_helpers; });
+    }
 } // namespace HPHP
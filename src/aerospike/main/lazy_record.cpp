@@ -0,0 +1,472 @@
+#include "lazy_record.h"
+#include "conversions.h"
+#include "ext_aerospike.h"
+#include "constants.h"
+#include "hphp/runtime/base/runtime-error.h"
+
+namespace HPHP {
+    /*
+     *******************************************************************************************
+     * Function to copy an as_record, so that it outlives the C client's
+     * callback it was passed to.
+     * Scalar values may be embedded in the bins of the record, so they are
+     * copied. Lists and maps are reserved instead.
+     *
+     * @param record_p      The as_record to be copied
+     *
+     * @return the new as_record if success. Otherwise NULL.
+     *******************************************************************************************
+     */
+    static as_record* copy_as_record(const as_record *record_p)
+    {
+        as_record   *copy_p = as_record_new(record_p->bins.size);
+
+        if (!copy_p) {
+            return NULL;
+        }
+
+        copy_p->gen = record_p->gen;
+        copy_p->ttl = record_p->ttl;
+
+        for (uint16_t iter = 0; iter < record_p->bins.size; iter++) {
+            const as_bin    *bin_p = &record_p->bins.entries[iter];
+            const char      *bin_name_p = as_bin_get_name(bin_p);
+            as_val          *value_p = (as_val *) as_bin_get_value(bin_p);
+
+            switch (as_val_type(value_p)) {
+                case AS_INTEGER:
+                    as_record_set_int64(copy_p, bin_name_p,
+                            as_integer_get((as_integer *) value_p));
+                    break;
+                case AS_DOUBLE:
+                    as_record_set_double(copy_p, bin_name_p,
+                            as_double_get((as_double *) value_p));
+                    break;
+                case AS_STRING:
+                    {
+                        as_string   *string_p = (as_string *) value_p;
+                        size_t      length = as_string_len(string_p);
+                        char        *buffer_p = (char *) malloc(length + 1);
+
+                        if (!buffer_p) {
+                            as_record_destroy(copy_p);
+                            return NULL;
+                        }
+                        memcpy(buffer_p, as_string_get(string_p), length);
+                        buffer_p[length] = '\0';
+                        as_record_set_string(copy_p, bin_name_p,
+                                as_string_new_wlen(buffer_p, length, true));
+                        break;
+                    }
+                case AS_BYTES:
+                    {
+                        as_bytes    *bytes_p = (as_bytes *) value_p;
+                        uint8_t     *buffer_p = (uint8_t *) malloc(bytes_p->size);
+
+                        if (!buffer_p) {
+                            as_record_destroy(copy_p);
+                            return NULL;
+                        }
+                        memcpy(buffer_p, bytes_p->value, bytes_p->size);
+                        as_record_set_raw_typep(copy_p, bin_name_p, buffer_p,
+                                bytes_p->size, as_bytes_get_type(bytes_p), true);
+                        break;
+                    }
+                case AS_NIL:
+                    as_record_set_nil(copy_p, bin_name_p);
+                    break;
+                default:
+                    as_val_reserve(value_p);
+                    as_record_set(copy_p, bin_name_p, (as_bin_value *) value_p);
+            }
+        }
+
+        return copy_p;
+    }
+
+    /*
+     ************************************************************************************
+     * Definitions of Member functions of Class AerospikeRecord declared in
+     * lazy_record.h
+     ************************************************************************************
+     */
+    AerospikeRecord::AerospikeRecord() { }
+
+    AerospikeRecord& AerospikeRecord::operator=(const AerospikeRecord& that)
+    {
+        if (this != &that) {
+            if (record_p) {
+                as_record_destroy(record_p);
+            }
+            record_p = that.record_p ? copy_as_record(that.record_p) : NULL;
+            php_key = that.php_key;
+            php_metadata = that.php_metadata;
+            decoded_bins = that.decoded_bins;
+            unset_bins = that.unset_bins;
+            boolean_bins = that.boolean_bins;
+            is_collections = that.is_collections;
+            is_decode_json = that.is_decode_json;
+        }
+        return *this;
+    }
+
+    /*
+     ************************************************************************************
+     * The PHP values are reclaimed with the request, so only the as_record is
+     * destroyed on sweep.
+     ************************************************************************************
+     */
+    void AerospikeRecord::sweep()
+    {
+        if (record_p) {
+            as_record_destroy(record_p);
+            record_p = NULL;
+        }
+        php_key.detach();
+        php_metadata.detach();
+        decoded_bins.detach();
+        unset_bins.detach();
+        boolean_bins.detach();
+    }
+
+    AerospikeRecord::~AerospikeRecord()
+    {
+        if (record_p) {
+            as_record_destroy(record_p);
+            record_p = NULL;
+        }
+    }
+
+    /*
+     ************************************************************************************
+     * Method to tell whether the record has a bin
+     *
+     * @param bin_name      The bin name
+     ************************************************************************************
+     */
+    bool AerospikeRecord::has_bin(const Variant& bin_name)
+    {
+        if (!bin_name.isString() || unset_bins.exists(bin_name)) {
+            return false;
+        }
+        if (decoded_bins.exists(bin_name)) {
+            return true;
+        }
+        return record_p && as_record_get(record_p, bin_name.toString().c_str());
+    }
+
+    /*
+     ************************************************************************************
+     * Method to get the PHP value of a bin, converting and caching it on
+     * first access. The bin is converted as the read that returned the record
+     * would have, honouring its OPT_COLLECTIONS, OPT_DECODE_JSON and
+     * OPT_BOOLEAN_BINS hints.
+     *
+     * @param bin_name      The bin name
+     *
+     * @return the PHP value of the bin. NULL if the record has no such bin,
+     * or if it cannot be converted, in which case a warning carrying the
+     * error is raised.
+     ************************************************************************************
+     */
+    Variant AerospikeRecord::get_bin(const Variant& bin_name)
+    {
+        as_error    error;
+        Variant     php_value;
+
+        if (!bin_name.isString() || unset_bins.exists(bin_name)) {
+            return init_null();
+        }
+        if (decoded_bins.exists(bin_name)) {
+            return decoded_bins[bin_name];
+        }
+        if (!record_p) {
+            return init_null();
+        }
+
+        CollectionsScope collections_scope(is_collections);
+        DecodeJsonScope decode_json_scope(is_decode_json);
+        as_bin_value *value_p = as_record_get(record_p, bin_name.toString().c_str());
+        if (!value_p) {
+            return init_null();
+        }
+        if (AEROSPIKE_OK != as_val_to_php_variant((as_val *) value_p, php_value, error)) {
+            raise_warning("Aerospike\\Record: unable to convert the bin %s: %s",
+                    bin_name.toString().c_str(), error.message);
+            return init_null();
+        }
+        if (php_value.isInteger() && boolean_bins.exists(bin_name)) {
+            php_value = php_value.toBoolean();
+        }
+        decoded_bins.set(bin_name, php_value);
+        return php_value;
+    }
+
+    /*
+     ************************************************************************************
+     * Method to get the PHP values of all the bins, as the bins array of a
+     * record array.
+     ************************************************************************************
+     */
+    Array AerospikeRecord::get_bins()
+    {
+        Array php_bins = Array::Create();
+
+        if (record_p) {
+            for (uint16_t iter = 0; iter < record_p->bins.size; iter++) {
+                String bin_name(as_bin_get_name(&record_p->bins.entries[iter]));
+                if (!unset_bins.exists(bin_name)) {
+                    php_bins.set(bin_name, get_bin(bin_name));
+                }
+            }
+        }
+        for (ArrayIter iter(decoded_bins); iter; ++iter) {
+            if (!php_bins.exists(iter.first())) {
+                php_bins.set(iter.first(), iter.second());
+            }
+        }
+        return php_bins;
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to tell whether OPT_LAZY_RECORD is set within the options
+     *
+     * @param options       The options of the read call
+     *******************************************************************************************
+     */
+    bool is_lazy_record_requested(const Variant& options)
+    {
+        return options.isArray() && options.toArray().exists(OPT_LAZY_RECORD) &&
+            options.toArray()[OPT_LAZY_RECORD].toBoolean();
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to convert as_record into an Aerospike\Record object. Lists
+     * and maps of its bins are converted into collections, and blobs decoded
+     * as JSON, if the caller is within a CollectionsScope or a DecodeJsonScope
+     * requesting them.
+     *
+     * @param record_p      as_record to be converted by this function
+     * @param key_p         as_key to be used to populate the PHP key of the
+     *                      record
+     * @param php_record    PHP Variant reference to be set to the object
+     * @param key_policy_p  The key policy of the read
+     * @param adopt_record  If true, the object takes over the as_record, which
+     *                      must then not be destroyed by the caller. Otherwise
+     *                      the object holds a copy of it.
+     * @param error         as_error reference to be populated by this function
+     *                      in case of error
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status as_record_to_lazy_record(as_record *record_p, const as_key *key_p,
+            Variant& php_record, as_policy_key *key_policy_p, bool adopt_record, as_error& error)
+    {
+        as_error_reset(&error);
+
+        if (!record_p) {
+            return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Record is null");
+        }
+
+        Class *record_class_p = Unit::loadClass(s_AerospikeRecordClass.get());
+        if (!record_class_p) {
+            if (adopt_record) {
+                as_record_destroy(record_p);
+            }
+            return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Unable to load the Aerospike\\Record class");
+        }
+
+        Object php_record_object{record_class_p};
+        auto data = Native::data<AerospikeRecord>(php_record_object.get());
+
+        data->php_key = Array::Create();
+        data->php_metadata = Array::Create();
+        data->decoded_bins = Array::Create();
+        data->unset_bins = Array::Create();
+        data->boolean_bins = Array::Create();
+        data->is_collections = CollectionsScope::requested();
+        data->is_decode_json = DecodeJsonScope::requested();
+        as_key_to_php_key(key_p ? key_p : &record_p->key, data->php_key, key_policy_p, error);
+        metadata_to_php_metadata(record_p, data->php_metadata, error);
+
+        if (adopt_record) {
+            data->record_p = record_p;
+        } else if (NULL == (data->record_p = copy_as_record(record_p))) {
+            return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Unable to copy the record: Memory allocation failed");
+        }
+
+        php_record = Variant(php_record_object);
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to set the bin names hinted as booleans by OPT_BOOLEAN_BINS on
+     * an Aerospike\Record object, for its integer bins to be converted into
+     * booleans on access. Other values are left as they are.
+     *
+     * @param boolean_bins  The bin names hinted as booleans
+     * @param php_record    The Aerospike\Record object
+     *******************************************************************************************
+     */
+    void apply_boolean_bins_hint_to_lazy_record(const Array& boolean_bins,
+            const Variant& php_record)
+    {
+        if (boolean_bins.empty() || !php_record.isObject() ||
+                !php_record.toObject()->instanceof(s_AerospikeRecordClass)) {
+            return;
+        }
+
+        auto data = Native::data<AerospikeRecord>(php_record.toObject().get());
+        for (ArrayIter iter(boolean_bins); iter; ++iter) {
+            if (iter.second().isString()) {
+                data->boolean_bins.set(iter.second(), true);
+            }
+        }
+    }
+
+    /* {{{ proto bool Aerospike\Record::offsetExists( string bin )
+       Tells whether the record has the bin */
+    bool HHVM_METHOD(AerospikeRecord, offsetExists, const Variant& bin_name)
+    {
+        auto data = Native::data<AerospikeRecord>(this_);
+        return data->has_bin(bin_name);
+    }
+    /* }}} */
+
+    /* {{{ proto mixed Aerospike\Record::offsetGet( string bin )
+       Returns the value of the bin, converted on first access */
+    Variant HHVM_METHOD(AerospikeRecord, offsetGet, const Variant& bin_name)
+    {
+        auto data = Native::data<AerospikeRecord>(this_);
+        return data->get_bin(bin_name);
+    }
+    /* }}} */
+
+    /* {{{ proto void Aerospike\Record::offsetSet( string bin, mixed value )
+       Overrides the value of the bin within the object */
+    void HHVM_METHOD(AerospikeRecord, offsetSet, const Variant& bin_name, const Variant& value)
+    {
+        auto data = Native::data<AerospikeRecord>(this_);
+
+        if (bin_name.isString()) {
+            data->unset_bins.remove(bin_name);
+            data->decoded_bins.set(bin_name, value);
+        }
+    }
+    /* }}} */
+
+    /* {{{ proto void Aerospike\Record::offsetUnset( string bin )
+       Removes the bin from the object */
+    void HHVM_METHOD(AerospikeRecord, offsetUnset, const Variant& bin_name)
+    {
+        auto data = Native::data<AerospikeRecord>(this_);
+
+        if (bin_name.isString()) {
+            data->decoded_bins.remove(bin_name);
+            data->unset_bins.set(bin_name, true);
+        }
+    }
+    /* }}} */
+
+    /* {{{ proto int Aerospike\Record::count( void )
+       Returns the number of bins, without converting them */
+    int64_t HHVM_METHOD(AerospikeRecord, count)
+    {
+        auto        data = Native::data<AerospikeRecord>(this_);
+        int64_t     bin_count = 0;
+
+        if (data->record_p) {
+            for (uint16_t iter = 0; iter < data->record_p->bins.size; iter++) {
+                String bin_name(as_bin_get_name(&data->record_p->bins.entries[iter]));
+                if (!data->unset_bins.exists(bin_name)) {
+                    bin_count++;
+                }
+            }
+        }
+        for (ArrayIter iter(data->decoded_bins); iter; ++iter) {
+            if (!data->record_p ||
+                    !as_record_get(data->record_p, iter.first().toString().c_str())) {
+                bin_count++;
+            }
+        }
+        return bin_count;
+    }
+    /* }}} */
+
+    /* {{{ proto array Aerospike\Record::getKey( void )
+       Returns the key of the record */
+    Array HHVM_METHOD(AerospikeRecord, getKey)
+    {
+        auto data = Native::data<AerospikeRecord>(this_);
+        return data->php_key;
+    }
+    /* }}} */
+
+    /* {{{ proto array Aerospike\Record::getMetadata( void )
+       Returns the metadata of the record */
+    Array HHVM_METHOD(AerospikeRecord, getMetadata)
+    {
+        auto data = Native::data<AerospikeRecord>(this_);
+        return data->php_metadata;
+    }
+    /* }}} */
+
+    /* {{{ proto array Aerospike\Record::getBins( void )
+       Returns all the bins, converting the ones not accessed yet */
+    Array HHVM_METHOD(AerospikeRecord, getBins)
+    {
+        auto data = Native::data<AerospikeRecord>(this_);
+        return data->get_bins();
+    }
+    /* }}} */
+
+    /* {{{ proto array Aerospike\Record::toArray( void )
+       Returns the record array Aerospike::get() returns without OPT_LAZY_RECORD */
+    Array HHVM_METHOD(AerospikeRecord, toArray)
+    {
+        auto data = Native::data<AerospikeRecord>(this_);
+        Array php_record = Array::Create();
+
+        php_record.set(s_key, data->php_key);
+        php_record.set(s_metadata, data->php_metadata);
+        php_record.set(s_bins, data->get_bins());
+        return php_record;
+    }
+    /* }}} */
+
+    /*
+     *******************************************************************************************
+     * Function to register the methods and native data of the Aerospike\Record
+     * class. Called on module init.
+     *******************************************************************************************
+     */
+    void register_lazy_record_class()
+    {
+        Native::registerBuiltinFunction("Aerospike\\Record->offsetExists",
+                HHVM_MN(AerospikeRecord, offsetExists));
+        Native::registerBuiltinFunction("Aerospike\\Record->offsetGet",
+                HHVM_MN(AerospikeRecord, offsetGet));
+        Native::registerBuiltinFunction("Aerospike\\Record->offsetSet",
+                HHVM_MN(AerospikeRecord, offsetSet));
+        Native::registerBuiltinFunction("Aerospike\\Record->offsetUnset",
+                HHVM_MN(AerospikeRecord, offsetUnset));
+        Native::registerBuiltinFunction("Aerospike\\Record->count",
+                HHVM_MN(AerospikeRecord, count));
+        Native::registerBuiltinFunction("Aerospike\\Record->getKey",
+                HHVM_MN(AerospikeRecord, getKey));
+        Native::registerBuiltinFunction("Aerospike\\Record->getMetadata",
+                HHVM_MN(AerospikeRecord, getMetadata));
+        Native::registerBuiltinFunction("Aerospike\\Record->getBins",
+                HHVM_MN(AerospikeRecord, getBins));
+        Native::registerBuiltinFunction("Aerospike\\Record->toArray",
+                HHVM_MN(AerospikeRecord, toArray));
+
+        Native::registerNativeDataInfo<AerospikeRecord>(s_AerospikeRecord.get());
+    }
+} // namespace HPHP
@@ -1,6 +1,7 @@
 #include "scan_operation.h"
 #include "conversions.h"
 #include "ext_aerospike.h"
+#include "lazy_record.h"
 
 #include "hphp/runtime/base/builtin-functions.h"
 #include "hphp/runtime/base/program-functions.h"
@@ -34,13 +35,22 @@ namespace HPHP {
         if (g_context.isNull()) {
             hphp_session_init();
         }
-        Array           temp_php_record = Array::Create();
         foreach_callback_user_udata      *conversion_data_p = (foreach_callback_user_udata *)udata;
-
-        as_record_to_php_record(record_p, &record_p->key, temp_php_record, NULL, conversion_data_p->error);
-
+        CollectionsScope                 collections_scope(conversion_data_p->is_collections);
+        DecodeJsonScope                  decode_json_scope(conversion_data_p->is_decode_json);
         Array php_record = Array::Create();
-        php_record.append(temp_php_record);
+
+        if (conversion_data_p->is_lazy_record) {
+            Variant     temp_php_record;
+            as_record_to_lazy_record(record_p, &record_p->key, temp_php_record, NULL, false,
+                    conversion_data_p->error);
+            php_record.append(temp_php_record);
+        } else {
+            Array       temp_php_record = Array::Create();
+            as_record_to_php_record(record_p, &record_p->key, temp_php_record, NULL, conversion_data_p->error,
+                    &conversion_data_p->bin_names);
+            php_record.append(temp_php_record);
+        }
         Variant ret = vm_call_user_func(conversion_data_p->function, php_record);
 
         bool do_continue = true;
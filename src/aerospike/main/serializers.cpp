@@ -0,0 +1,1220 @@
+#include "serializers.h"
+#include "policy.h"
+#include "hphp/runtime/base/string-buffer.h"
+#include "hphp/runtime/base/mixed-array.h"
+#include "hphp/runtime/base/packed-array.h"
+#include "hphp/runtime/base/variable-unserializer.h"
+#include "hphp/runtime/ext/std/ext_std_variable.h"
+#include "hphp/system/systemlib.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <locale.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <zlib.h>
+
+namespace HPHP {
+    const StaticString s_empty_property("_empty_");
+
+    /*
+     *******************************************************************************************
+     * Class to encode a PHP value in the format of the native binary serializer.
+     * See serializers.h for the format.
+     *******************************************************************************************
+     */
+    class BinaryEncoder {
+        private:
+            StringBuffer                                buffer;
+            std::unordered_map<std::string, uint32_t>   strings;
+            as_error&                                   error;
+
+            void write_byte(uint8_t byte) { buffer.append((char) byte); }
+            void write_varint(uint64_t value);
+            void write_fixed(uint64_t value, uint32_t size);
+            void write_integer(int64_t value);
+            void write_string(const String& php_string);
+            bool write_value(const Variant& php_value, uint32_t depth);
+
+        public:
+            explicit BinaryEncoder(as_error& init_error) : error(init_error) {}
+            as_status encode(const Variant& php_value, String& serialized_string);
+    };
+
+    void BinaryEncoder::write_varint(uint64_t value)
+    {
+        while (value >= 0x80) {
+            write_byte((uint8_t) (value | 0x80));
+            value >>= 7;
+        }
+        write_byte((uint8_t) value);
+    }
+
+    void BinaryEncoder::write_fixed(uint64_t value, uint32_t size)
+    {
+        for (uint32_t iter = 0; iter < size; iter++) {
+            write_byte((uint8_t) (value >> (8 * iter)));
+        }
+    }
+
+    void BinaryEncoder::write_integer(int64_t value)
+    {
+        if (value >= 0 && value <= 0x7F) {
+            write_byte(BINARY_TAG_FIXINT | (uint8_t) value);
+        } else if (value >= INT8_MIN && value <= INT8_MAX) {
+            write_byte(BINARY_TAG_INT8);
+            write_fixed((uint64_t) value, 1);
+        } else if (value >= INT16_MIN && value <= INT16_MAX) {
+            write_byte(BINARY_TAG_INT16);
+            write_fixed((uint64_t) value, 2);
+        } else if (value >= INT32_MIN && value <= INT32_MAX) {
+            write_byte(BINARY_TAG_INT32);
+            write_fixed((uint64_t) value, 4);
+        } else {
+            write_byte(BINARY_TAG_INT64);
+            write_fixed((uint64_t) value, 8);
+        }
+    }
+
+    void BinaryEncoder::write_string(const String& php_string)
+    {
+        uint32_t size = php_string.size();
+
+        if (size <= BINARY_STRING_DEDUP_MAX_LEN) {
+            auto inserted = strings.emplace(std::string(php_string.data(), size),
+                    strings.size());
+            if (!inserted.second) {
+                write_byte(BINARY_TAG_STRING_REF);
+                write_varint(inserted.first->second);
+                return;
+            }
+        }
+        write_byte(BINARY_TAG_STRING);
+        write_varint(size);
+        buffer.append(php_string.data(), size);
+    }
+
+    /*
+     * Writes the tagged php_value, where depth is the nesting depth of the
+     * arrays and objects it would be written as.
+     */
+    bool BinaryEncoder::write_value(const Variant& php_value, uint32_t depth)
+    {
+        if (php_value.isNull()) {
+            write_byte(BINARY_TAG_NULL);
+        } else if (php_value.isBoolean()) {
+            write_byte(php_value.toBoolean() ? BINARY_TAG_TRUE : BINARY_TAG_FALSE);
+        } else if (php_value.isInteger()) {
+            write_integer(php_value.toInt64());
+        } else if (php_value.isDouble()) {
+            double      php_double = php_value.toDouble();
+            uint64_t    bits;
+
+            memcpy(&bits, &php_double, sizeof(bits));
+            write_byte(BINARY_TAG_DOUBLE);
+            write_fixed(bits, sizeof(bits));
+        } else if (php_value.isString()) {
+            write_string(php_value.toString());
+        } else if (php_value.isArray() || (php_value.isObject() &&
+                    php_value.toCObjRef()->getVMClass() == SystemLib::s_stdclassClass)) {
+            if ((int64_t) depth > ini_entry.nesting_depth) {
+                as_error_update(&error, AEROSPIKE_ERR_PARAM,
+                        "Nesting depth of the value exceeds aerospike.nesting_depth");
+                return false;
+            }
+
+            bool    is_stdclass = php_value.isObject();
+            Array   php_array = is_stdclass ? php_value.toCObjRef()->o_toArray() :
+                php_value.toArray();
+            bool    is_list = !is_stdclass && php_array->isVectorData();
+
+            write_byte(is_stdclass ? BINARY_TAG_STDCLASS :
+                    (is_list ? BINARY_TAG_LIST : BINARY_TAG_ARRAY));
+            write_varint(php_array.size());
+            for (ArrayIter iter(php_array); iter; ++iter) {
+                if (is_stdclass) {
+                    write_string(iter.first().toString());
+                } else if (!is_list) {
+                    if (iter.first().isInteger()) {
+                        write_integer(iter.first().toInt64());
+                    } else {
+                        write_string(iter.first().toString());
+                    }
+                }
+                if (!write_value(iter.secondRef(), depth + 1)) {
+                    return false;
+                }
+            }
+        } else {
+            /*
+             * Objects may define how they are serialized, so these are
+             * left to the PHP serializer.
+             */
+            String serialized_object = f_serialize(php_value);
+
+            write_byte(BINARY_TAG_SERIALIZED);
+            write_varint(serialized_object.size());
+            buffer.append(serialized_object);
+        }
+        return true;
+    }
+
+    as_status BinaryEncoder::encode(const Variant& php_value, String& serialized_string)
+    {
+        write_byte(BINARY_MAGIC);
+        write_byte(BINARY_VERSION);
+        if (write_value(php_value, 1)) {
+            serialized_string = buffer.detach();
+        }
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Class to decode a PHP value from the format of the native binary
+     * serializer. Every read is bounds checked, so that corrupt or foreign
+     * bytes fail with an error instead of being read past their end.
+     *******************************************************************************************
+     */
+    class BinaryDecoder {
+        private:
+            const uint8_t           *pos_p;
+            const uint8_t           *end_p;
+            std::vector<String>     strings;
+            as_error&               error;
+
+            bool corrupt();
+            bool read_byte(uint8_t& byte);
+            bool read_varint(uint64_t& value);
+            bool read_fixed(uint64_t& value, uint32_t size);
+            bool read_string(uint8_t tag, String& php_string);
+            bool read_count(uint64_t& count);
+            bool read_value(Variant& php_value, uint32_t depth);
+
+        public:
+            BinaryDecoder(const uint8_t *bytes_p, uint32_t size, as_error& init_error) :
+                pos_p(bytes_p), end_p(bytes_p + size), error(init_error) {}
+            as_status decode(Variant& php_value);
+    };
+
+    bool BinaryDecoder::corrupt()
+    {
+        if (AEROSPIKE_OK == error.code) {
+            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Unable to unserialize bytes: corrupt binary serialized value");
+        }
+        return false;
+    }
+
+    bool BinaryDecoder::read_byte(uint8_t& byte)
+    {
+        if (pos_p >= end_p) {
+            return corrupt();
+        }
+        byte = *pos_p++;
+        return true;
+    }
+
+    bool BinaryDecoder::read_varint(uint64_t& value)
+    {
+        uint8_t byte;
+
+        value = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7) {
+            if (!read_byte(byte)) {
+                return false;
+            }
+            value |= ((uint64_t) (byte & 0x7F)) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return corrupt();
+    }
+
+    bool BinaryDecoder::read_fixed(uint64_t& value, uint32_t size)
+    {
+        if ((uint64_t) (end_p - pos_p) < size) {
+            return corrupt();
+        }
+        value = 0;
+        for (uint32_t iter = 0; iter < size; iter++) {
+            value |= ((uint64_t) *pos_p++) << (8 * iter);
+        }
+        return true;
+    }
+
+    bool BinaryDecoder::read_string(uint8_t tag, String& php_string)
+    {
+        uint64_t size;
+
+        if (BINARY_TAG_STRING_REF == tag) {
+            if (!read_varint(size) || size >= strings.size()) {
+                return corrupt();
+            }
+            php_string = strings[size];
+            return true;
+        }
+        if (BINARY_TAG_STRING != tag || !read_varint(size) ||
+                (uint64_t) (end_p - pos_p) < size) {
+            return corrupt();
+        }
+        php_string = String((const char *) pos_p, size, CopyString);
+        pos_p += size;
+        if (size <= BINARY_STRING_DEDUP_MAX_LEN) {
+            strings.push_back(php_string);
+        }
+        return true;
+    }
+
+    /*
+     * Reads the count of an array, which can not exceed the bytes left since
+     * every element takes at least one byte.
+     */
+    bool BinaryDecoder::read_count(uint64_t& count)
+    {
+        if (!read_varint(count) || count > (uint64_t) (end_p - pos_p)) {
+            return corrupt();
+        }
+        return true;
+    }
+
+    bool BinaryDecoder::read_value(Variant& php_value, uint32_t depth)
+    {
+        uint8_t     tag;
+        uint64_t    value;
+
+        if (!read_byte(tag)) {
+            return false;
+        }
+
+        if (tag & BINARY_TAG_FIXINT) {
+            php_value = (int64_t) (tag & 0x7F);
+            return true;
+        }
+
+        switch (tag) {
+            case BINARY_TAG_NULL:
+                php_value.setNull();
+                return true;
+            case BINARY_TAG_FALSE:
+            case BINARY_TAG_TRUE:
+                php_value = (BINARY_TAG_TRUE == tag);
+                return true;
+            case BINARY_TAG_INT8:
+                if (!read_fixed(value, 1)) {
+                    return false;
+                }
+                php_value = (int64_t) (int8_t) value;
+                return true;
+            case BINARY_TAG_INT16:
+                if (!read_fixed(value, 2)) {
+                    return false;
+                }
+                php_value = (int64_t) (int16_t) value;
+                return true;
+            case BINARY_TAG_INT32:
+                if (!read_fixed(value, 4)) {
+                    return false;
+                }
+                php_value = (int64_t) (int32_t) value;
+                return true;
+            case BINARY_TAG_INT64:
+                if (!read_fixed(value, 8)) {
+                    return false;
+                }
+                php_value = (int64_t) value;
+                return true;
+            case BINARY_TAG_DOUBLE:
+                {
+                    double php_double;
+
+                    if (!read_fixed(value, sizeof(value))) {
+                        return false;
+                    }
+                    memcpy(&php_double, &value, sizeof(php_double));
+                    php_value = php_double;
+                    return true;
+                }
+            case BINARY_TAG_STRING:
+            case BINARY_TAG_STRING_REF:
+                {
+                    String php_string;
+
+                    if (!read_string(tag, php_string)) {
+                        return false;
+                    }
+                    php_value = php_string;
+                    return true;
+                }
+            case BINARY_TAG_SERIALIZED:
+                {
+                    if (!read_varint(value) || (uint64_t) (end_p - pos_p) < value) {
+                        return corrupt();
+                    }
+                    php_value = unserialize_ex((const char *) pos_p, value,
+                            VariableUnserializer::Type::Serialize);
+                    /*
+                     * unserialize_ex() returns false when it fails, which
+                     * is only a valid result for the serialized false.
+                     */
+                    if (php_value.isBoolean() && !php_value.toBoolean() &&
+                            !(4 == value && 0 == memcmp(pos_p, "b:0;", 4))) {
+                        return corrupt();
+                    }
+                    pos_p += value;
+                    return true;
+                }
+            case BINARY_TAG_ARRAY:
+            case BINARY_TAG_LIST:
+            case BINARY_TAG_STDCLASS:
+                break;
+            default:
+                return corrupt();
+        }
+
+        if ((int64_t) depth > ini_entry.nesting_depth) {
+            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Nesting depth of the value exceeds aerospike.nesting_depth");
+            return false;
+        }
+
+        uint64_t    count;
+        Variant     php_element;
+
+        if (!read_count(count)) {
+            return false;
+        }
+
+        if (BINARY_TAG_STDCLASS == tag) {
+            Object php_object = SystemLib::AllocStdClassObject();
+
+            for (uint64_t iter = 0; iter < count; iter++) {
+                String  php_name;
+                uint8_t name_tag;
+
+                if (!read_byte(name_tag) || !read_string(name_tag, php_name) ||
+                        !read_value(php_element, depth + 1)) {
+                    return false;
+                }
+                php_object->o_set(php_name, php_element);
+            }
+            php_value = php_object;
+            return true;
+        }
+
+        if (BINARY_TAG_LIST == tag) {
+            Array php_list = Array::attach(PackedArray::MakeReserve(count));
+
+            for (uint64_t iter = 0; iter < count; iter++) {
+                if (!read_value(php_element, depth + 1)) {
+                    return false;
+                }
+                php_list.append(php_element);
+            }
+            php_value = php_list;
+            return true;
+        }
+
+        Array   php_array = Array::attach(MixedArray::MakeReserveMixed(count));
+        Variant php_key;
+
+        for (uint64_t iter = 0; iter < count; iter++) {
+            if (!read_value(php_key, depth) || !(php_key.isInteger() || php_key.isString()) ||
+                    !read_value(php_element, depth + 1)) {
+                return corrupt();
+            }
+            php_array.set(php_key, php_element);
+        }
+        php_value = php_array;
+        return true;
+    }
+
+    as_status BinaryDecoder::decode(Variant& php_value)
+    {
+        uint8_t magic;
+        uint8_t version;
+
+        if (!read_byte(magic) || !read_byte(version) ||
+                BINARY_MAGIC != magic || BINARY_VERSION != version) {
+            return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Unable to unserialize bytes: not a binary serialized value");
+        }
+        if (read_value(php_value, 1) && pos_p != end_p) {
+            corrupt();
+        }
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Class to have the C locale used by the formatting and parsing functions
+     * of the thread within the lifetime of the scope, so that JSON numbers
+     * are written and read with a '.' whatever the locale set by the script.
+     *******************************************************************************************
+     */
+    class CLocaleScope {
+        private:
+            locale_t    previous_locale;
+
+        public:
+            CLocaleScope()
+            {
+                static const locale_t c_locale = newlocale(LC_ALL_MASK, "C", (locale_t) 0);
+                previous_locale = uselocale(c_locale);
+            }
+            ~CLocaleScope() { uselocale(previous_locale); }
+    };
+
+    /*
+     *******************************************************************************************
+     * Class to encode a PHP value as JSON text, written straight into the
+     * serialized string. See serializers.h for the mapping of PHP values.
+     *******************************************************************************************
+     */
+    class JsonEncoder {
+        private:
+            StringBuffer    buffer;
+            as_error&       error;
+
+            bool fail(const char *message_p);
+            bool write_string(const String& php_string);
+            void write_double(double php_double);
+            bool write_value(const Variant& php_value, uint32_t depth);
+
+        public:
+            explicit JsonEncoder(as_error& init_error) : error(init_error) {}
+            as_status encode(const Variant& php_value, String& serialized_string);
+    };
+
+    bool JsonEncoder::fail(const char *message_p)
+    {
+        as_error_update(&error, AEROSPIKE_ERR_PARAM, message_p);
+        return false;
+    }
+
+    /*
+     * Writes the string quoted and escaped, copying the runs of characters
+     * which need no escaping at once.
+     */
+    bool JsonEncoder::write_string(const String& php_string)
+    {
+        static const char   hex_digits[] = "0123456789abcdef";
+        const uint8_t       *pos_p = (const uint8_t *) php_string.data();
+        const uint8_t       *end_p = pos_p + php_string.size();
+        const uint8_t       *run_p = pos_p;
+
+        buffer.append('"');
+        while (pos_p < end_p) {
+            uint8_t c = *pos_p;
+
+            if (c >= 0x80) {
+                uint32_t    size;
+                uint32_t    code_point;
+
+                if ((c & 0xE0) == 0xC0) {
+                    size = 2;
+                    code_point = c & 0x1F;
+                } else if ((c & 0xF0) == 0xE0) {
+                    size = 3;
+                    code_point = c & 0x0F;
+                } else if ((c & 0xF8) == 0xF0) {
+                    size = 4;
+                    code_point = c & 0x07;
+                } else {
+                    return fail("Unable to serialize using JSON serializer: invalid UTF-8 string");
+                }
+                if ((uint32_t) (end_p - pos_p) < size) {
+                    return fail("Unable to serialize using JSON serializer: invalid UTF-8 string");
+                }
+                for (uint32_t iter = 1; iter < size; iter++) {
+                    if ((pos_p[iter] & 0xC0) != 0x80) {
+                        return fail("Unable to serialize using JSON serializer: invalid UTF-8 string");
+                    }
+                    code_point = (code_point << 6) | (pos_p[iter] & 0x3F);
+                }
+                if ((size == 2 && code_point < 0x80) || (size == 3 && code_point < 0x800) ||
+                        (size == 4 && code_point < 0x10000) || code_point > 0x10FFFF ||
+                        (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+                    return fail("Unable to serialize using JSON serializer: invalid UTF-8 string");
+                }
+                pos_p += size;
+                continue;
+            }
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                pos_p++;
+                continue;
+            }
+
+            buffer.append((const char *) run_p, pos_p - run_p);
+            switch (c) {
+                case '"':
+                    buffer.append("\\\"", 2);
+                    break;
+                case '\\':
+                    buffer.append("\\\\", 2);
+                    break;
+                case '\n':
+                    buffer.append("\\n", 2);
+                    break;
+                case '\r':
+                    buffer.append("\\r", 2);
+                    break;
+                case '\t':
+                    buffer.append("\\t", 2);
+                    break;
+                default:
+                    {
+                        char escaped[] = { '\\', 'u', '0', '0', hex_digits[c >> 4], hex_digits[c & 0x0F] };
+                        buffer.append(escaped, sizeof(escaped));
+                    }
+            }
+            run_p = ++pos_p;
+        }
+        buffer.append((const char *) run_p, pos_p - run_p);
+        buffer.append('"');
+        return true;
+    }
+
+    /*
+     * Writes the shortest of 15 or 17 significant digits that reads back as the
+     * same double, always with a fraction or an exponent so that it is read
+     * back as a float.
+     */
+    void JsonEncoder::write_double(double php_double)
+    {
+        CLocaleScope    c_locale_scope;
+        char            digits[32];
+        int             size = snprintf(digits, sizeof(digits), "%.15g", php_double);
+
+        if (strtod(digits, NULL) != php_double) {
+            size = snprintf(digits, sizeof(digits), "%.17g", php_double);
+        }
+        buffer.append(digits, size);
+        if (!strpbrk(digits, ".eE")) {
+            buffer.append(".0", 2);
+        }
+    }
+
+    /*
+     * Writes php_value, where depth is the nesting depth of the arrays and
+     * objects it would be written as.
+     */
+    bool JsonEncoder::write_value(const Variant& php_value, uint32_t depth)
+    {
+        if (php_value.isNull()) {
+            buffer.append("null", 4);
+        } else if (php_value.isBoolean()) {
+            if (php_value.toBoolean()) {
+                buffer.append("true", 4);
+            } else {
+                buffer.append("false", 5);
+            }
+        } else if (php_value.isInteger()) {
+            char    digits[24];
+            int     size = snprintf(digits, sizeof(digits), "%lld", (long long) php_value.toInt64());
+
+            buffer.append(digits, size);
+        } else if (php_value.isDouble()) {
+            if (!std::isfinite(php_value.toDouble())) {
+                return fail("Unable to serialize using JSON serializer: INF and NAN can not be serialized");
+            }
+            write_double(php_value.toDouble());
+        } else if (php_value.isString()) {
+            return write_string(php_value.toString());
+        } else if (php_value.isArray() || php_value.isObject()) {
+            if ((int64_t) depth > ini_entry.nesting_depth) {
+                return fail("Nesting depth of the value exceeds aerospike.nesting_depth");
+            }
+
+            bool    is_object = php_value.isObject();
+            Array   php_array = !is_object ? php_value.toArray() :
+                php_value.toCObjRef()->o_toArray(
+                        php_value.toCObjRef()->getVMClass() != SystemLib::s_stdclassClass);
+            bool    is_list = !is_object && php_array->isVectorData();
+            bool    is_first = true;
+
+            buffer.append(is_list ? '[' : '{');
+            for (ArrayIter iter(php_array); iter; ++iter) {
+                if (!is_first) {
+                    buffer.append(',');
+                }
+                is_first = false;
+                if (!is_list) {
+                    if (!write_string(iter.first().toString())) {
+                        return false;
+                    }
+                    buffer.append(':');
+                }
+                if (!write_value(iter.secondRef(), depth + 1)) {
+                    return false;
+                }
+            }
+            buffer.append(is_list ? ']' : '}');
+        } else {
+            return fail("Unable to serialize using JSON serializer: unsupported type");
+        }
+        return true;
+    }
+
+    as_status JsonEncoder::encode(const Variant& php_value, String& serialized_string)
+    {
+        if (write_value(php_value, 1)) {
+            serialized_string = buffer.detach();
+        }
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Class to decode a PHP value from JSON text in a single pass over the
+     * serialized bytes. Strings without escapes are copied from the bytes at
+     * once.
+     *******************************************************************************************
+     */
+    class JsonDecoder {
+        private:
+            const char      *pos_p;
+            const char      *end_p;
+            as_error&       error;
+
+            bool corrupt();
+            void skip_whitespace();
+            bool read_literal(const char *literal_p, uint32_t size);
+            bool read_hex(uint32_t& code_point);
+            bool read_string(String& php_string);
+            bool read_number(Variant& php_value);
+            bool read_value(Variant& php_value, uint32_t depth);
+
+        public:
+            JsonDecoder(const uint8_t *bytes_p, uint32_t size, as_error& init_error) :
+                pos_p((const char *) bytes_p), end_p((const char *) bytes_p + size),
+                error(init_error) {}
+            as_status decode(Variant& php_value);
+    };
+
+    bool JsonDecoder::corrupt()
+    {
+        if (AEROSPIKE_OK == error.code) {
+            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Unable to unserialize bytes: invalid JSON serialized value");
+        }
+        return false;
+    }
+
+    void JsonDecoder::skip_whitespace()
+    {
+        while (pos_p < end_p && (*pos_p == ' ' || *pos_p == '\n' || *pos_p == '\r' || *pos_p == '\t')) {
+            pos_p++;
+        }
+    }
+
+    bool JsonDecoder::read_literal(const char *literal_p, uint32_t size)
+    {
+        if ((uint32_t) (end_p - pos_p) < size || memcmp(pos_p, literal_p, size)) {
+            return corrupt();
+        }
+        pos_p += size;
+        return true;
+    }
+
+    bool JsonDecoder::read_hex(uint32_t& code_point)
+    {
+        if (end_p - pos_p < 4) {
+            return corrupt();
+        }
+        code_point = 0;
+        for (uint32_t iter = 0; iter < 4; iter++) {
+            char c = *pos_p++;
+            code_point <<= 4;
+            if (c >= '0' && c <= '9') {
+                code_point |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                code_point |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                code_point |= c - 'A' + 10;
+            } else {
+                return corrupt();
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Reads the string following its opening quote.
+     */
+    bool JsonDecoder::read_string(String& php_string)
+    {
+        const char      *run_p = pos_p;
+        StringBuffer    unescaped;
+        bool            is_escaped = false;
+
+        while (true) {
+            if (pos_p >= end_p || (uint8_t) *pos_p < 0x20) {
+                return corrupt();
+            }
+            if (*pos_p == '"') {
+                break;
+            }
+            if (*pos_p != '\\') {
+                pos_p++;
+                continue;
+            }
+
+            is_escaped = true;
+            unescaped.append(run_p, pos_p - run_p);
+            if (++pos_p >= end_p) {
+                return corrupt();
+            }
+            switch (*pos_p++) {
+                case '"':
+                    unescaped.append('"');
+                    break;
+                case '\\':
+                    unescaped.append('\\');
+                    break;
+                case '/':
+                    unescaped.append('/');
+                    break;
+                case 'b':
+                    unescaped.append('\b');
+                    break;
+                case 'f':
+                    unescaped.append('\f');
+                    break;
+                case 'n':
+                    unescaped.append('\n');
+                    break;
+                case 'r':
+                    unescaped.append('\r');
+                    break;
+                case 't':
+                    unescaped.append('\t');
+                    break;
+                case 'u':
+                    {
+                        uint32_t code_point;
+                        uint32_t low_surrogate;
+
+                        if (!read_hex(code_point)) {
+                            return false;
+                        }
+                        if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+                            return corrupt();
+                        }
+                        if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                            if (!read_literal("\\u", 2) || !read_hex(low_surrogate) ||
+                                    low_surrogate < 0xDC00 || low_surrogate > 0xDFFF) {
+                                return corrupt();
+                            }
+                            code_point = 0x10000 + ((code_point - 0xD800) << 10) +
+                                (low_surrogate - 0xDC00);
+                        }
+                        if (code_point < 0x80) {
+                            unescaped.append((char) code_point);
+                        } else if (code_point < 0x800) {
+                            unescaped.append((char) (0xC0 | (code_point >> 6)));
+                            unescaped.append((char) (0x80 | (code_point & 0x3F)));
+                        } else if (code_point < 0x10000) {
+                            unescaped.append((char) (0xE0 | (code_point >> 12)));
+                            unescaped.append((char) (0x80 | ((code_point >> 6) & 0x3F)));
+                            unescaped.append((char) (0x80 | (code_point & 0x3F)));
+                        } else {
+                            unescaped.append((char) (0xF0 | (code_point >> 18)));
+                            unescaped.append((char) (0x80 | ((code_point >> 12) & 0x3F)));
+                            unescaped.append((char) (0x80 | ((code_point >> 6) & 0x3F)));
+                            unescaped.append((char) (0x80 | (code_point & 0x3F)));
+                        }
+                        break;
+                    }
+                default:
+                    return corrupt();
+            }
+            run_p = pos_p;
+        }
+
+        if (is_escaped) {
+            unescaped.append(run_p, pos_p - run_p);
+            php_string = unescaped.detach();
+        } else {
+            php_string = String(run_p, pos_p - run_p, CopyString);
+        }
+        pos_p++;
+        return true;
+    }
+
+    bool JsonDecoder::read_number(Variant& php_value)
+    {
+        const char  *start_p = pos_p;
+        bool        is_integer = true;
+        char        digits[JSON_NUMBER_MAX_LEN + 1];
+
+        if (pos_p < end_p && *pos_p == '-') {
+            pos_p++;
+        }
+        if (pos_p >= end_p || !isdigit((unsigned char) *pos_p)) {
+            return corrupt();
+        }
+        while (pos_p < end_p && isdigit((unsigned char) *pos_p)) {
+            pos_p++;
+        }
+        if (pos_p < end_p && *pos_p == '.') {
+            is_integer = false;
+            if (++pos_p >= end_p || !isdigit((unsigned char) *pos_p)) {
+                return corrupt();
+            }
+            while (pos_p < end_p && isdigit((unsigned char) *pos_p)) {
+                pos_p++;
+            }
+        }
+        if (pos_p < end_p && (*pos_p == 'e' || *pos_p == 'E')) {
+            is_integer = false;
+            if (++pos_p < end_p && (*pos_p == '+' || *pos_p == '-')) {
+                pos_p++;
+            }
+            if (pos_p >= end_p || !isdigit((unsigned char) *pos_p)) {
+                return corrupt();
+            }
+            while (pos_p < end_p && isdigit((unsigned char) *pos_p)) {
+                pos_p++;
+            }
+        }
+
+        size_t size = pos_p - start_p;
+        if (size > JSON_NUMBER_MAX_LEN) {
+            return corrupt();
+        }
+        memcpy(digits, start_p, size);
+        digits[size] = '\0';
+
+        if (is_integer) {
+            errno = 0;
+            long long php_integer = strtoll(digits, NULL, 10);
+            if (errno != ERANGE) {
+                php_value = (int64_t) php_integer;
+                return true;
+            }
+        }
+        CLocaleScope c_locale_scope;
+        php_value = strtod(digits, NULL);
+        return true;
+    }
+
+    bool JsonDecoder::read_value(Variant& php_value, uint32_t depth)
+    {
+        skip_whitespace();
+        if (pos_p >= end_p) {
+            return corrupt();
+        }
+
+        switch (*pos_p) {
+            case '"':
+                {
+                    String php_string;
+
+                    pos_p++;
+                    if (!read_string(php_string)) {
+                        return false;
+                    }
+                    php_value = php_string;
+                    return true;
+                }
+            case 't':
+                php_value = true;
+                return read_literal("true", 4);
+            case 'f':
+                php_value = false;
+                return read_literal("false", 5);
+            case 'n':
+                php_value.setNull();
+                return read_literal("null", 4);
+            case '[':
+            case '{':
+                break;
+            default:
+                return read_number(php_value);
+        }
+
+        if ((int64_t) depth > ini_entry.nesting_depth) {
+            as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Nesting depth of the value exceeds aerospike.nesting_depth");
+            return false;
+        }
+
+        bool    is_list = (*pos_p++ == '[');
+        char    close = is_list ? ']' : '}';
+        Array   php_list = Array::Create();
+        Object  php_object;
+        Variant php_element;
+
+        if (!is_list) {
+            php_object = SystemLib::AllocStdClassObject();
+        }
+
+        skip_whitespace();
+        if (pos_p < end_p && *pos_p == close) {
+            pos_p++;
+        } else {
+            while (true) {
+                if (is_list) {
+                    if (!read_value(php_element, depth + 1)) {
+                        return false;
+                    }
+                    php_list.append(php_element);
+                } else {
+                    String php_name;
+
+                    skip_whitespace();
+                    if (pos_p >= end_p || *pos_p++ != '"' || !read_string(php_name)) {
+                        return corrupt();
+                    }
+                    skip_whitespace();
+                    if (pos_p >= end_p || *pos_p++ != ':' ||
+                            !read_value(php_element, depth + 1)) {
+                        return corrupt();
+                    }
+                    php_object->o_set(php_name.empty() ? s_empty_property : php_name, php_element);
+                }
+
+                skip_whitespace();
+                if (pos_p >= end_p) {
+                    return corrupt();
+                }
+                if (*pos_p == ',') {
+                    pos_p++;
+                } else if (*pos_p++ == close) {
+                    break;
+                } else {
+                    return corrupt();
+                }
+            }
+        }
+
+        if (is_list) {
+            php_value = php_list;
+        } else {
+            php_value = php_object;
+        }
+        return true;
+    }
+
+    as_status JsonDecoder::decode(Variant& php_value)
+    {
+        if (read_value(php_value, 1)) {
+            skip_whitespace();
+            if (pos_p != end_p) {
+                corrupt();
+            }
+        }
+        return error.code;
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to serialize a PHP value using the native binary serializer.
+     *
+     * @param php_value             The PHP value to be serialized
+     * @param serialized_string     The PHP string to be populated with the
+     *                              serialized value
+     * @param error                 as_error reference to be populated by this function
+     *                              in case of error
+     *
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status binary_serialize(const Variant& php_value, String& serialized_string,
+            as_error& error)
+    {
+        as_error_reset(&error);
+
+        BinaryEncoder encoder(error);
+        return encoder.encode(php_value, serialized_string);
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to unserialize a value serialized by the native binary
+     * serializer.
+     *
+     * @param bytes_p               The serialized bytes
+     * @param size                  The number of serialized bytes
+     * @param php_value             The PHP Variant reference to be populated with the
+     *                              unserialized value
+     * @param error                 as_error reference to be populated by this function
+     *                              in case of error
+     *
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status binary_unserialize(const uint8_t *bytes_p, uint32_t size, Variant& php_value,
+            as_error& error)
+    {
+        as_error_reset(&error);
+
+        BinaryDecoder decoder(bytes_p, size, error);
+        return decoder.decode(php_value);
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to serialize a PHP value using the native JSON serializer.
+     *
+     * @param php_value             The PHP value to be serialized
+     * @param serialized_string     The PHP string to be populated with the
+     *                              JSON text
+     * @param error                 as_error reference to be populated by this function
+     *                              in case of error
+     *
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status json_serialize(const Variant& php_value, String& serialized_string,
+            as_error& error)
+    {
+        as_error_reset(&error);
+
+        JsonEncoder encoder(error);
+        return encoder.encode(php_value, serialized_string);
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to unserialize a value serialized by the native JSON serializer.
+     *
+     * @param bytes_p               The JSON text
+     * @param size                  The number of bytes of the JSON text
+     * @param php_value             The PHP Variant reference to be populated with the
+     *                              unserialized value
+     * @param error                 as_error reference to be populated by this function
+     *                              in case of error
+     *
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status json_unserialize(const uint8_t *bytes_p, uint32_t size, Variant& php_value,
+            as_error& error)
+    {
+        as_error_reset(&error);
+
+        JsonDecoder decoder(bytes_p, size, error);
+        return decoder.decode(php_value);
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to compress a serialized value using zlib.
+     *
+     * @param serialized_string     The serialized value to be compressed
+     * @param compressed_string     The PHP string to be populated with the
+     *                              compressed value
+     *
+     * @return true if the value got compressed. Otherwise false, if zlib failed,
+     * the value is larger than COMPRESSED_MAX_SIZE or did not get smaller, and
+     * it is to be stored uncompressed.
+     *******************************************************************************************
+     */
+    bool compress_serialized(const String& serialized_string, String& compressed_string)
+    {
+        uLong   size = serialized_string.size();
+        uLongf  compressed_size = compressBound(size);
+
+        if (size > COMPRESSED_MAX_SIZE) {
+            return false;
+        }
+
+        String  buffer(COMPRESSED_HEADER_SIZE + compressed_size, ReserveString);
+        uint8_t *buffer_p = (uint8_t *) buffer.mutableData();
+
+        buffer_p[0] = BINARY_MAGIC;
+        buffer_p[1] = BINARY_VERSION | BINARY_FLAG_COMPRESSED;
+        for (uint32_t iter = 0; iter < 4; iter++) {
+            buffer_p[2 + iter] = (uint8_t) (size >> (8 * iter));
+        }
+        if (Z_OK != compress2(buffer_p + COMPRESSED_HEADER_SIZE, &compressed_size,
+                    (const Bytef *) serialized_string.data(), size, Z_DEFAULT_COMPRESSION) ||
+                COMPRESSED_HEADER_SIZE + compressed_size >= size) {
+            return false;
+        }
+        buffer.setSize(COMPRESSED_HEADER_SIZE + compressed_size);
+        compressed_string = buffer;
+        return true;
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to check whether serialized bytes are a value compressed by
+     * compress_serialized().
+     *
+     * @param bytes_p               The serialized bytes
+     * @param size                  The number of serialized bytes
+     *
+     * @return true if the header of the bytes is flagged as compressed.
+     *******************************************************************************************
+     */
+    bool is_compressed_serialized(const uint8_t *bytes_p, uint32_t size)
+    {
+        return size >= 2 && BINARY_MAGIC == bytes_p[0] &&
+            (bytes_p[1] & BINARY_FLAG_COMPRESSED);
+    }
+
+    /*
+     *******************************************************************************************
+     * Function to decompress a value compressed by compress_serialized().
+     *
+     * @param bytes_p               The compressed bytes
+     * @param size                  The number of compressed bytes
+     * @param serialized_string     The PHP string to be populated with the
+     *                              serialized value
+     * @param error                 as_error reference to be populated by this function
+     *                              in case of error
+     *
+     * @return AEROSPIKE_OK if success. Otherwise AEROSPIKE_ERR_*.
+     *******************************************************************************************
+     */
+    as_status decompress_serialized(const uint8_t *bytes_p, uint32_t size,
+            String& serialized_string, as_error& error)
+    {
+        as_error_reset(&error);
+
+        if (size < COMPRESSED_HEADER_SIZE ||
+                BINARY_MAGIC != bytes_p[0] ||
+                (BINARY_VERSION | BINARY_FLAG_COMPRESSED) != bytes_p[1]) {
+            return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Unable to unserialize bytes: not a compressed value");
+        }
+
+        uLongf expected_size = 0;
+        for (uint32_t iter = 0; iter < 4; iter++) {
+            expected_size |= ((uLongf) bytes_p[2 + iter]) << (8 * iter);
+        }
+
+        /*
+         * Larger values are never compressed, so the size is corrupt and
+         * must not be allocated.
+         */
+        if (expected_size > COMPRESSED_MAX_SIZE) {
+            return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Unable to unserialize bytes: corrupt compressed value");
+        }
+
+        String  buffer(expected_size, ReserveString);
+        uLongf  serialized_size = expected_size;
+
+        if (Z_OK != uncompress((Bytef *) buffer.mutableData(), &serialized_size,
+                    bytes_p + COMPRESSED_HEADER_SIZE, size - COMPRESSED_HEADER_SIZE) ||
+                serialized_size != expected_size ||
+                is_compressed_serialized((const uint8_t *) buffer.data(), serialized_size)) {
+            return as_error_update(&error, AEROSPIKE_ERR_CLIENT,
+                    "Unable to unserialize bytes: corrupt compressed value");
+        }
+        buffer.setSize(serialized_size);
+        serialized_string = buffer;
+        return error.code;
+    }
+} // namespace HPHP
@@ -31,6 +31,11 @@ function bin_udf_operation_bool(record , bin_name)
     return record[bin_name]
 end
 
+--[[UDF which returns the size of the bytes stored in a bin.--]]
+function bin_bytes_size(record, bin_name)
+    return bytes.size(record[bin_name])
+end
+
 --[[UDF which modifies element of list.--]]
 function list_iterate(record, bin, index_of_ele)
     local get_list = record[bin]
@@ -0,0 +1,9 @@
+--TEST--
+Connection - Check instance stats of a persistent connection.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Connection", "testGetInstanceStats");
+--EXPECT--
+OK
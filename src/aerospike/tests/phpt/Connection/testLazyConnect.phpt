@@ -0,0 +1,9 @@
+--TEST--
+Connection - Check lazy connect defers the connection until needed.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Connection", "testLazyConnect");
+--EXPECT--
+OK
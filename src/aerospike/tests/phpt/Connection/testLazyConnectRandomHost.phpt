@@ -0,0 +1,9 @@
+--TEST--
+Lazy connect, Config with random host(IP:PORT)
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Connection", "testLazyConnectRandomHost");
+--EXPECT--
+ERR_CLUSTER
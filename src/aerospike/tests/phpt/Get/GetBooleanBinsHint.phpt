@@ -0,0 +1,9 @@
+--TEST--
+Get - Booleans written natively and hinted by OPT_BOOLEAN_BINS.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Get", "testGetBooleanBinsHint");
+--EXPECT--
+OK
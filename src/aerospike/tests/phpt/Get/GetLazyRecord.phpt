@@ -0,0 +1,9 @@
+--TEST--
+Get - Record returned as an Aerospike\Record object with OPT_LAZY_RECORD.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Get", "testGetLazyRecord");
+--EXPECT--
+OK
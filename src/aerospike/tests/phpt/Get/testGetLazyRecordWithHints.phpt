@@ -0,0 +1,9 @@
+--TEST--
+Get - Aerospike\Record object honouring OPT_BOOLEAN_BINS and OPT_COLLECTIONS.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Get", "testGetLazyRecordWithHints");
+--EXPECT--
+OK
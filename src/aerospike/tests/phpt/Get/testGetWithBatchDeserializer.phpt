@@ -0,0 +1,9 @@
+--TEST--
+Get - User serialized bins deserialized with a single batched deserializer call.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Get", "testGetWithBatchDeserializer");
+--EXPECT--
+OK
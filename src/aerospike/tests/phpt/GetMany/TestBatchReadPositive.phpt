@@ -0,0 +1,9 @@
+--TEST--
+GetMany - batchRead with bins selected per key
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("GetMany", "testBatchReadPositive");
+--EXPECT--
+OK
@@ -0,0 +1,9 @@
+--TEST--
+GetMany - batch reads split into chunks by aerospike.batch_max_keys
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("GetMany", "testGetManyChunkedPositive");
+--EXPECT--
+OK
@@ -0,0 +1,9 @@
+--TEST--
+GetMany - records returned in the order of the keys with OPT_POSITIONAL_RESULTS
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("GetMany", "testGetManyPositionalResultsPositive");
+--EXPECT--
+OK
@@ -0,0 +1,9 @@
+--TEST--
+GetMany - records passed to a callback by getManyStream, one by one or in chunks
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("GetMany", "testGetManyStreamPositive");
+--EXPECT--
+OK
@@ -0,0 +1,9 @@
+--TEST--
+Put - Nested List with more values than a single pool chunk.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Put", "testPutLargeNestedList");
+--EXPECT--
+OK
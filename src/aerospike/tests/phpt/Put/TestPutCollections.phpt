@@ -0,0 +1,9 @@
+--TEST--
+Put - Hack collections written as lists and maps, read back with OPT_COLLECTIONS.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Put", "testPutCollections");
+--EXPECT--
+OK
@@ -0,0 +1,9 @@
+--TEST--
+Put - Serialized values compressed above aerospike.compression_threshold.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Put", "testPutCompressed");
+--EXPECT--
+OK
@@ -0,0 +1,9 @@
+--TEST--
+Put - Float values written as native doubles and as serialized floats.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Put", "testPutFloatNative");
+--EXPECT--
+OK
@@ -0,0 +1,9 @@
+--TEST--
+Put - putMany, operateMany and removeMany on a batch of keys
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Put", "testPutManyOperateManyRemoveMany");
+--EXPECT--
+OK
@@ -0,0 +1,9 @@
+--TEST--
+Put - Values nested up to and deeper than aerospike.nesting_depth.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Put", "testPutNestingDepth");
+--EXPECT--
+OK
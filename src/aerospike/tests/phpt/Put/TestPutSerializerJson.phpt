@@ -0,0 +1,9 @@
+--TEST--
+Put - Values written with the native JSON serializer.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Put", "testPutSerializerJson");
+--EXPECT--
+OK
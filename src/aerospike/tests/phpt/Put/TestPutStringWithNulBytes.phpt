@@ -0,0 +1,9 @@
+--TEST--
+Put - Strings holding NUL bytes written and read back whole.
+
+--FILE--
+<?php
+include dirname(__FILE__)."/../../astestframework/astest-phpt-loader.inc";
+aerospike_phpt_runtest("Put", "testPutStringWithNulBytes");
+--EXPECT--
+OK